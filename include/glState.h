@@ -0,0 +1,43 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <cstddef>
+
+// Shadow copy of the GL binding and fixed-function state the renderer changes. The Cached calls only reach
+// the driver when the value differs from the shadow, and both outcomes are counted.
+//
+// State changed behind the cache's back (ImGui, objects deleted while bound and then reused) makes the shadow
+// wrong, so InvalidateGLState must be called after such code; BeginFrame does it once per frame.
+
+// Calls that reached the driver and calls dropped as redundant since the last ResetGLStateStats
+struct GLStateStats {
+    size_t issued = 0;
+    size_t skipped = 0;
+};
+
+void CachedUseProgram(unsigned int program);
+void CachedBindVertexArray(unsigned int vao);
+
+// GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO, so it is always passed through
+void CachedBindBuffer(unsigned int target, unsigned int buffer);
+
+// Indexed bindings also set the generic binding of target, and the shadow follows
+void CachedBindBufferBase(unsigned int target, unsigned int index, unsigned int buffer);
+void CachedBindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size);
+
+// Make unit active (0 for GL_TEXTURE0) and bind texture to target on it
+void CachedBindTexture(unsigned int unit, unsigned int target, unsigned int texture);
+
+void CachedEnable(unsigned int capability);
+void CachedDisable(unsigned int capability);
+void CachedDepthMask(bool write);
+void CachedDepthFunc(unsigned int func);
+void CachedColorMask(bool write);
+
+// Forget every shadowed value so the next call of each kind reaches the driver
+void InvalidateGLState();
+
+const GLStateStats& GetGLStateStats();
+void ResetGLStateStats();
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef GPUBUFFERS_H
+#define GPUBUFFERS_H
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include "riceLoader.h"
+
+// Hands out ranges of a buffer by offset. The smallest free range that fits is used,
+// and released ranges merge with free neighbours so the space stays in as few pieces as possible.
+struct RangeAllocator {
+    size_t capacity = 0;
+    size_t used = 0;
+    std::map<size_t, size_t> freeByOffset;     // offset -> size
+    std::multimap<size_t, size_t> freeBySize;  // size -> offset, for best fit
+    std::map<size_t, size_t> allocations;      // offset -> size of every live range
+};
+
+// Reset the allocator to one free range of capacity units
+void InitRangeAllocator(RangeAllocator& allocator, size_t capacity);
+
+// Take size units (size > 0); returns false when no free range is large enough
+bool AllocateRange(RangeAllocator& allocator, size_t size, size_t& offset);
+
+// Return a range taken by AllocateRange
+void FreeRange(RangeAllocator& allocator, size_t offset);
+
+// Extend the capacity, adding the new space as free
+void GrowRangeAllocator(RangeAllocator& allocator, size_t capacity);
+
+// Size of the largest free range
+size_t LargestFreeRange(const RangeAllocator& allocator);
+
+// One VAO over a VBO and EBO shared by every model stored in the same vertex format.
+// The VBO holds each vertex stream for `vertices.capacity` vertices back to back, so a model is addressed by
+// base vertex. Index ranges are in bytes and start on 4 bytes, so 16 and 32 bit indices share the EBO.
+struct MeshArena {
+    VertexFormat format;
+    bool hasTangents = false;
+    unsigned int vao = 0;     // Stays the same when the buffers are regrown or compacted
+    unsigned int vbo = 0;
+    unsigned int ebo = 0;
+    RangeAllocator vertices;  // In vertices
+    RangeAllocator indices;   // In bytes
+};
+
+// Large shared buffers that models are sub-allocated from instead of getting their own VAO, VBO and EBO
+struct GpuBufferPool {
+    std::vector<MeshArena> arenas;      // One per vertex format and tangent stream
+    size_t initialVertices = 1 << 16;   // Capacity of a new arena; full arenas double
+    size_t initialIndexBytes = 1 << 20;
+};
+
+// Find or create the arena for a format
+int AcquireMeshArena(GpuBufferPool& pool, const VertexFormat& format, bool hasTangents);
+
+// Reserve vertex and index ranges in an arena, growing its buffers when they are full.
+// Growing replaces the VBO and EBO, so VAOs made over them with SetupMeshArenaAttributes must be recreated.
+bool AllocateMeshArenaRanges(GpuBufferPool& pool, int arena, size_t vertexCount, size_t indexBytes, GpuAllocation& allocation);
+
+// Copy vertices packed by PackVertices (followed by PackTangents output when the arena has tangents)
+// and raw index bytes into an allocation
+void WriteMeshArenaVertices(const MeshArena& arena, const GpuAllocation& allocation, const std::vector<unsigned char>& packed);
+void WriteMeshArenaIndices(const MeshArena& arena, const GpuAllocation& allocation, const void* indices, size_t bytes);
+
+// Give an allocation's ranges back to its arena
+void FreeMeshArenaRanges(GpuBufferPool& pool, GpuAllocation& allocation);
+
+// Point attributes 0-3 and the element buffer of the bound VAO at the arena's buffers
+void SetupMeshArenaAttributes(const MeshArena& arena);
+
+// Move every live range to the front of its arena so the free space is one range again.
+// models must list every model loaded into the pool; their base vertices and index offsets are updated.
+void DefragmentGpuBufferPool(GpuBufferPool& pool, const std::vector<Model*>& models);
+
+// Delete the buffers of every arena; models loaded into the pool must be unloaded first
+void ReleaseGpuBufferPool(GpuBufferPool& pool);
+
+#endif
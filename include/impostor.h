@@ -0,0 +1,46 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "camera.h"
+#include "riceLoader.h"
+#include "shaderVariants.h"
+
+// Settings for impostor baking and use
+struct ImpostorOptions {
+    unsigned int framesPerSide = 8;  // The atlas holds framesPerSide^2 views on an octahedral grid
+    unsigned int frameSize = 128;    // Pixels per view
+    float switchDistance = 20.0f;    // Distance from the camera beyond which the impostor replaces the model
+};
+
+// Views of a model baked into an octahedral atlas, drawn as one textured quad
+struct Impostor {
+    unsigned int albedoTexture = 0;  // RGB albedo, alpha is coverage
+    unsigned int normalTexture = 0;  // Object space normals packed into [0, 1]
+    unsigned int framesPerSide = 0;
+    float switchDistance = 0.0f;
+    glm::vec3 center = glm::vec3(0.0f); // Bounding sphere of the model in object space
+    float radius = 0.0f;
+    unsigned int vao = 0;            // Unit quad
+    unsigned int vbo = 0;
+};
+
+// Render the model from every atlas direction into an offscreen framebuffer.
+// bakeShaders holds default.vs with impostorBake.fs; each material is drawn by the variant that samples
+// its diffuse map when it has one. Restores the framebuffer and viewport afterwards.
+bool BakeImpostor(Model& model, ShaderVariantCache& bakeShaders, const ImpostorOptions& options, Impostor& impostor);
+
+// True when the model is far enough from Camera::Position to be replaced by its impostor
+bool ShouldDrawImpostor(const Impostor& impostor, const Camera& camera, float time);
+
+// Draw the impostor as a quad facing the camera, using the nearest baked view and relighting its normals
+void DrawImpostor(
+    Impostor& impostor, Shader& impostorShader, Camera& camera,
+    const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT,
+    glm::vec3 lightPos, glm::vec3 lightColor, float time);
+
+// Release the atlas and the quad
+void UnloadImpostor(Impostor& impostor);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "riceLoader.h"
+#include "shaderVariants.h"
+
+// Per-instance parameters of a batch drawn with the INSTANCING variant of default.vs
+struct InstanceData {
+    glm::mat4 model = glm::mat4(1.0f);   // Instance transform, applied before the batch's model matrix
+    glm::vec4 tint = glm::vec4(1.0f);    // Multiplies the diffuse color
+};
+
+// Many copies of one model drawn with a single instanced call per submesh.
+// The VAO reads the model's VBO and EBO plus an instance buffer stepped once per instance.
+struct InstanceBatch {
+    unsigned int vao = 0;
+    unsigned int instanceBuffer = 0;
+    size_t instanceCount = 0;
+    size_t capacity = 0;         // Instances the buffer has room for
+};
+
+// Create the batch VAO over a model already uploaded with LoadModelToGPU
+bool CreateInstanceBatch(const Model& model, InstanceBatch& batch);
+
+// Copy the instances into the instance buffer, growing it when needed. Normal matrices are computed here.
+void UploadInstances(InstanceBatch& batch, const InstanceData* instances, size_t count);
+void UploadInstances(InstanceBatch& batch, const std::vector<InstanceData>& instances);
+
+// Draw every instance at full detail with glDrawElementsInstancedBaseVertex, one call per submesh.
+// parent is applied on top of every instance transform. Each material uses its INSTANCING variant from shaders.
+void DrawModelInstanced(const Model& model, const InstanceBatch& batch, ShaderVariantCache& shaders, const glm::mat4& parent);
+
+// Release the batch VAO and instance buffer; the model's buffers are left alone
+void UnloadInstanceBatch(InstanceBatch& batch);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef MESHANALYZER_H
+#define MESHANALYZER_H
+
+#include <cstddef>
+#include "riceLoader.h"
+#include "meshOptimizer.h"
+
+// Settings for mesh analysis
+struct MeshAnalyzeOptions {
+    VertexFormat format;                // GPU vertex format assumed for fetch and memory numbers
+    unsigned int cacheSize = 16;        // Post-transform cache size for the FIFO and LRU simulations
+    unsigned int overdrawViews = 8;     // Directions the mesh is rasterized from to estimate overdraw
+    unsigned int rasterSize = 256;      // Resolution of the software depth buffer
+    unsigned int fetchCacheLine = 64;   // Memory transaction size in bytes for vertex fetch
+    unsigned int fetchCacheLines = 256; // Lines the simulated vertex fetch cache holds
+};
+
+// GPU-relevant statistics of an indexed mesh
+struct MeshAnalysis {
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    size_t triangleCount = 0;
+    float uniqueVertexRatio = 0.0f;  // Distinct vertices over all vertices (1.0 means no duplicates)
+    VertexCacheStats fifo = {};      // Post-transform cache behaviour with FIFO replacement
+    VertexCacheStats lru = {};       // Post-transform cache behaviour with LRU replacement
+    float overdraw = 0.0f;           // Depth test passes per covered pixel, averaged over the views (1.0 is ideal)
+    float fetchOverfetch = 0.0f;     // Bytes loaded through the fetch cache per byte of referenced vertices (1.0 is ideal)
+    float bytesPerTriangle = 0.0f;   // Vertex and index memory per triangle in the given format
+};
+
+// Simulate an LRU post-transform cache over an index buffer
+VertexCacheStats AnalyzeVertexCacheLru(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Estimate overdraw by rasterizing the triangles in order, back faces culled, into a depth buffer from
+// viewCount directions spread over the sphere. Returns depth test passes per covered pixel.
+float AnalyzeOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, unsigned int viewCount = 8, unsigned int rasterSize = 256);
+
+// Simulate vertex fetch through a cache of fixed-size lines over the buffer layout of the format.
+// Returns the bytes loaded per byte of referenced vertex data.
+float AnalyzeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount, const VertexFormat& format,
+    unsigned int cacheLine = 64, unsigned int cacheLines = 256);
+
+// Gather every statistic above for a mesh
+MeshAnalysis AnalyzeMesh(const Mesh& mesh, const MeshAnalyzeOptions& options = MeshAnalyzeOptions());
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <vector>
+#include <string>
+#include "riceLoader.h"
+#include "meshCleaner.h"
+#include "meshSimplifier.h"
+
+// Binary cache of processed meshes (.rlmesh) so runtime loads skip OBJ parsing and preprocessing.
+// Each mesh is stored as a list of tagged chunks; readers skip chunks they don't know.
+
+// The processing a cache was built with. It is stored in the cache header, and a cache built with
+// different settings is stale, so toggling a pass rebuilds it instead of silently reusing old data.
+struct MeshBuildSettings {
+    bool clean = true;
+    bool optimize = true;
+    bool tangents = false;
+    bool lods = true;
+    bool meshlets = true;
+    MeshCleanOptions cleanOptions;
+    LodChainOptions lodOptions;
+};
+
+// Write meshes with everything built for them (LODs, meshlets, bounds, tangents) to a cache file
+bool SaveMeshCache(const std::string& cachePath, const std::vector<Mesh>& meshes, const MeshBuildSettings& settings);
+
+// Read meshes from a cache file; GPU handles are left unset
+bool LoadMeshCache(const std::string& cachePath, std::vector<Mesh>& meshes);
+
+// True when the cache file is missing, older than the source model, of another format version,
+// or built with settings other than these
+bool IsMeshCacheStale(const std::string& cachePath, const std::string& sourcePath, const MeshBuildSettings& settings);
+
+#endif
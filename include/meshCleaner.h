@@ -0,0 +1,30 @@
+#ifndef MESHCLEANER_H
+#define MESHCLEANER_H
+
+#include <cstddef>
+#include "riceLoader.h"
+
+// Settings for the mesh cleaning pass
+struct MeshCleanOptions {
+    float weldDistance = 1e-5f;     // Positions closer than this fraction of the bounds diagonal are merged
+    float attributeEpsilon = 1e-4f; // Welded vertices must also agree on UVs and normals within this
+    bool removeDegenerates = true;  // Drop triangles with repeated vertices or no area
+    bool removeDuplicates = true;   // Drop repeated triangles with the same winding
+    unsigned int threads = 0;       // Worker threads, 0 uses every hardware thread
+};
+
+// What the cleaning pass removed
+struct MeshCleanReport {
+    size_t weldedVertices = 0;       // Vertices merged into an earlier one
+    size_t degenerateTriangles = 0;  // Triangles with repeated vertices or no area
+    size_t duplicateTriangles = 0;   // Repeats of an earlier triangle
+    size_t unreferencedVertices = 0; // Vertices no triangle uses after cleaning (welded ones included)
+};
+
+// Weld nearly coincident vertices through a spatial hash, remove degenerate and duplicate triangles,
+// and compact away unreferenced vertices. Every vertex maps to the lowest matching index and kept
+// vertices stay in their original order, so the result doesn't depend on the thread count.
+// Run before OptimizeMesh and the other passes, which all assume a clean index buffer.
+MeshCleanReport CleanMesh(Mesh& mesh, const MeshCleanOptions& options = MeshCleanOptions());
+
+#endif
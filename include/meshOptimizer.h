@@ -0,0 +1,44 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include <cstddef>
+#include "riceLoader.h"
+
+// Post-transform vertex cache statistics for an index buffer
+struct VertexCacheStats {
+    float acmr; // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal, 3.0 is worst)
+    float atvr; // Average transformed vertex ratio: transformed vertices per referenced vertex (1.0 is ideal)
+};
+
+// Which stages of the optimization pass to run
+struct MeshOptimizeOptions {
+    bool vertexCache = true;        // Reorder triangles for vertex cache locality (Forsyth)
+    bool overdraw = true;           // Reorder triangle clusters so occluders are drawn first
+    bool vertexFetch = true;        // Reorder vertices in first-use order
+    float overdrawThreshold = 1.05f; // Allowed ACMR growth when splitting clusters for overdraw
+    unsigned int cacheSize = 16;    // FIFO size used to report ACMR/ATVR
+};
+
+// Cache statistics before and after the optimization pass
+struct MeshOptimizeReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Simulate a FIFO post-transform cache over an index buffer
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Reorder triangles for vertex cache locality using Forsyth's linear-speed algorithm
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Reorder cache-optimized triangle clusters front-to-back relative to the mesh centroid
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+// Reorder vertices in the order they are first referenced and drop unreferenced ones
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// Run the enabled stages on an indexed mesh and report cache statistics before and after
+MeshOptimizeReport OptimizeMesh(Mesh& mesh, const MeshOptimizeOptions& options = MeshOptimizeOptions());
+
+#endif
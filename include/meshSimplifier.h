@@ -0,0 +1,34 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+#include <cstddef>
+#include "riceLoader.h"
+
+// Settings for building a mesh's LOD chain
+struct LodChainOptions {
+    std::vector<float> errorTargets = { 0.002f, 0.008f, 0.02f, 0.05f }; // Max error of each level, relative to the mesh radius
+    float reduction = 0.5f;     // Triangle ratio each level aims for relative to the previous one
+    float minReduction = 0.9f;  // Skip a level that keeps more than this ratio of the previous one
+};
+
+// One performed edge collapse: every corner on vertex `from` was moved onto vertex `to`
+struct EdgeCollapseRecord {
+    unsigned int from;
+    unsigned int to;
+    float error; // Object space error of this collapse
+};
+
+// Simplify an indexed triangle list with quadric error edge collapses.
+// Vertices are not modified; the returned indices reference the same vertex buffer.
+// Border vertices are kept in place; attribute seam vertices only collapse along edges both sides of the seam share.
+// collapseLog receives the collapses in the order they were applied, for progressive meshes.
+std::vector<unsigned int> SimplifyMesh(
+    const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float targetError, float* resultError = nullptr,
+    std::vector<EdgeCollapseRecord>* collapseLog = nullptr);
+
+// Build coarser levels of detail for a loaded mesh and store them after its full detail indices
+void BuildLodChain(Mesh& mesh, const LodChainOptions& options = LodChainOptions());
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "riceLoader.h"
+
+// Cluster size limits
+const size_t MESHLET_MAX_VERTICES = 64;
+const size_t MESHLET_MAX_TRIANGLES = 124;
+
+// Split the mesh's full detail triangles into meshlets with bounding spheres and normal cones
+void BuildMeshlets(Mesh& mesh);
+
+// Append draw ranges (index counts and byte offsets into the EBO) of meshlets that are inside
+// the frustum and not entirely back-facing. Returns the number of meshlets culled.
+size_t CullMeshlets(
+    const Mesh& mesh, const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+    std::vector<int>& counts, std::vector<const void*>& offsets);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef NORMALGENERATOR_H
+#define NORMALGENERATOR_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// Settings for vertex normal generation
+struct NormalGenerationOptions {
+    float creaseAngle = 60.0f;  // Faces meeting at a sharper angle (degrees) don't share normals
+    unsigned int threads = 0;   // Worker threads, 0 uses every hardware thread
+};
+
+// Smoothing group used for faces under "s off" / "s 0": never smoothed with neighbours
+const unsigned int SMOOTHING_GROUP_OFF = 0;
+
+// Compute one normal per triangle corner, weighted by face area and corner angle.
+// cornerPositions holds three position indices per triangle, smoothingGroups one group per triangle.
+// Corners only average faces at the same position that share their smoothing group and lie within
+// the crease angle. Each corner gathers from its neighbours independently, so the work runs in
+// parallel without atomics and the result doesn't depend on the thread count.
+std::vector<glm::vec3> GenerateCornerNormals(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& cornerPositions,
+    const std::vector<unsigned int>& smoothingGroups,
+    const NormalGenerationOptions& options = NormalGenerationOptions());
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use when the caller passes 0
+inline unsigned int DefaultThreadCount()
+{
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// Split [0, count) into contiguous ranges and run body(begin, end) for each on its own thread.
+// Ranges never overlap, so bodies that only write to their own range need no synchronization.
+// Work smaller than minBatch per thread runs inline on the calling thread.
+template <typename Body>
+void ParallelFor(size_t count, Body body, unsigned int threads = 0, size_t minBatch = 4096)
+{
+    if (count == 0)
+        return;
+
+    size_t threadCount = threads == 0 ? DefaultThreadCount() : threads;
+    threadCount = std::min(threadCount, (count + minBatch - 1) / minBatch);
+    if (threadCount <= 1)
+    {
+        body(size_t(0), count);
+        return;
+    }
+
+    size_t batch = (count + threadCount - 1) / threadCount;
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (size_t t = 1; t < threadCount; ++t)
+    {
+        size_t begin = std::min(t * batch, count);
+        size_t end = std::min(begin + batch, count);
+        workers.emplace_back([&body, begin, end]() { body(begin, end); });
+    }
+
+    // The calling thread takes the first range
+    body(size_t(0), std::min(batch, count));
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef PROGRESSIVEMESH_H
+#define PROGRESSIVEMESH_H
+
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+#include "riceLoader.h"
+
+// Progressive meshes (.rlprog): a coarse base mesh stored first, followed by refinement records that
+// each undo one edge collapse of the simplifier. Records are stored from the largest error down, so any
+// prefix of the file is a usable mesh and a viewer can draw the base while the rest is still arriving.
+
+// Settings for building a progressive mesh
+struct ProgressiveMeshOptions {
+    float baseRatio = 0.05f; // Fraction of the triangles kept in the base mesh
+    VertexFormat format;     // GPU vertex format the stream is packed in when loaded
+};
+
+// Undoes one edge collapse: adds a vertex, restores the triangles the collapse removed and moves the
+// corners it merged back onto the new vertex. The new vertex is numbered after every vertex before it.
+struct ProgressiveRecord {
+    Vertex vertex;
+    float error = 0.0f;                  // Object space error remaining once this record is applied
+    std::vector<unsigned int> triangles; // Restored triangles, three vertex indices each, appended to the index buffer
+    std::vector<unsigned int> corners;   // Positions in the index buffer that now reference the new vertex
+};
+
+// A mesh split into a base level and refinement records, ready to be written to disk
+struct ProgressiveMeshData {
+    std::vector<Vertex> baseVertices;
+    std::vector<unsigned int> baseIndices;
+    float baseError = 0.0f;                  // Object space error of the base mesh
+    float baseRatio = 0.0f;                  // ProgressiveMeshOptions::baseRatio it was built with
+    std::vector<ProgressiveRecord> records;  // Ordered by decreasing error; apply in order
+    VertexFormat format;
+    VertexQuantization quantization;         // Computed over every vertex, so streamed vertices pack consistently
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+};
+
+// A progressive mesh being streamed onto the GPU.
+// mesh holds the level refined so far and is drawn with Draw or DrawDepth through mesh.vao.
+struct ProgressiveMeshStream {
+    Mesh mesh = Mesh();
+    size_t totalVertices = 0;    // Vertex and triangle counts at full detail, known once the header arrived
+    size_t totalTriangles = 0;
+    size_t recordCount = 0;
+    size_t recordsApplied = 0;
+    float error = 0.0f;          // Object space error of the level currently drawn
+    bool failed = false;         // Set when the bytes are not a valid progressive mesh
+
+    // Streaming state
+    std::vector<char> pending;   // Bytes received but not parsed yet
+    bool headerRead = false;
+    size_t baseVertexCount = 0;
+    size_t baseTriangleCount = 0;
+    size_t uploadedVertices = 0;
+    size_t dirtyBegin = 0;       // Range of mesh.indices changed since the last upload
+    size_t dirtyEnd = 0;
+    unsigned int ebo = 0;
+};
+
+// Split a mesh into a base level and refinement records by logging the simplifier's collapses down to
+// options.baseRatio and replaying them in reverse. Tangents, LODs and meshlets are not carried over.
+bool BuildProgressiveMesh(const Mesh& mesh, const ProgressiveMeshOptions& options, ProgressiveMeshData& data);
+
+// Write the header and base mesh first, then the records in refinement order
+bool SaveProgressiveMesh(const std::string& path, const ProgressiveMeshData& data);
+
+// True when the progressive file is missing, older than the source model, of another version, or built
+// with another vertex format or base ratio than options
+bool IsProgressiveMeshStale(const std::string& path, const std::string& sourcePath, const ProgressiveMeshOptions& options);
+
+// Append bytes as they arrive from disk or the VFS; they are parsed by the next refinement
+void FeedProgressiveMesh(ProgressiveMeshStream& stream, const char* data, size_t size);
+
+// Parse the bytes received so far. The GPU buffers are created and the base mesh uploaded as soon as it is
+// complete; after that up to recordBudget records are applied and only the vertices and index range they
+// touched are uploaded. Returns the number of records applied.
+size_t RefineProgressiveMesh(ProgressiveMeshStream& stream, size_t recordBudget);
+
+// True once every record has been applied
+bool IsProgressiveMeshComplete(const ProgressiveMeshStream& stream);
+
+// Release the GPU buffers and reset the stream
+void UnloadProgressiveMesh(ProgressiveMeshStream& stream);
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "riceLoader.h"
+#include "shaderVariants.h"
+#include "staticBatch.h"
+
+// Passes in execution order; the pass is the top of every sort key
+enum class RenderPass : uint8_t {
+    Depth = 0,       // Positions only, front to back
+    Opaque = 1,      // Grouped by shader, material and VAO, front to back inside each group
+    Transparent = 2  // Back to front, state grouping only between equal depths
+};
+
+// Transform and vertex decode of one submitted object, shared by all of its submeshes
+struct RenderObject {
+    glm::mat4 model;
+    VertexFormat format;
+    VertexQuantization quantization;
+};
+
+// One queued draw
+struct RenderCommand {
+    const Mesh* mesh;
+    Shader* shader;
+    const Material* material; // nullptr in the depth pass
+    unsigned int vao;
+    unsigned int level;       // Level of detail picked at submission
+    unsigned int object;      // Index into RenderQueue::objects
+    const StaticBatch* batch; // Set for a static batch, which is culled per source instead of drawn by level
+};
+
+// A run of sorted commands submitted with one glMultiDrawElementsIndirect
+struct IndirectBatch {
+    const RenderCommand* command; // First command of the run, whose state the run shares
+    size_t first;                 // Range of RenderQueue::indirectCommands
+    size_t count;
+};
+
+// Draws collected for a frame, sorted by 64-bit key and executed with state changes only where state differs
+struct RenderQueue {
+    std::vector<RenderCommand> commands;
+    std::vector<uint64_t> keys;        // keys[i] belongs to commands[i]
+    std::vector<RenderObject> objects;
+    std::vector<uint32_t> order;       // Command indices in key order, filled by SortRenderQueue
+
+    // Frame state captured by BeginRenderQueue
+    Camera* camera = nullptr;
+    unsigned int screenHeight = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::unordered_map<const Material*, uint32_t> materialIds; // Dense ids for the key, assigned per frame
+
+    // Multi-draw indirect submission (GL 4.3 or ARB_multi_draw_indirect).
+    // When off, every command is drawn on its own as on a 3.3 context.
+    bool indirect = false;
+    unsigned int indirectBuffer = 0;
+    std::vector<DrawElementsIndirectCommand> indirectCommands;
+    std::vector<IndirectBatch> indirectBatches;
+
+    // Statistics of every pass executed this frame, reset by BeginRenderQueue
+    size_t shaderChanges = 0;
+    size_t materialChanges = 0;
+    size_t vaoChanges = 0;
+    size_t drawCalls[3] = {};  // Indexed by RenderPass
+};
+
+// Clear the queue and its statistics and capture the camera used for depth keys, LOD selection and culling
+void BeginRenderQueue(RenderQueue& queue, Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT);
+
+// Queue one mesh drawn through vao; material may be nullptr for the depth pass
+void SubmitMesh(
+    RenderQueue& queue, RenderPass pass, Mesh& mesh, unsigned int vao, Shader& shader,
+    const Material* material, const glm::mat4& model);
+
+// Queue every submesh of a model with its material, sharing one object
+void SubmitModel(RenderQueue& queue, RenderPass pass, Model& model, Shader& shader, const glm::mat4& modelMatrix);
+
+// Same, with each submesh drawn by the cheapest variant for its material
+void SubmitModel(RenderQueue& queue, RenderPass pass, Model& model, ShaderVariantCache& shaders, const glm::mat4& modelMatrix);
+
+// Queue static batches uploaded as the meshes of batchModel, batchModel.meshes[i] holding batches[i].
+// They are drawn with an identity model matrix and frustum culled per source when executed.
+void SubmitStaticBatches(
+    RenderQueue& queue, RenderPass pass, const std::vector<StaticBatch>& batches, Model& batchModel, Shader& shader);
+
+// Same, with each batch drawn by the cheapest variant for its material
+void SubmitStaticBatches(
+    RenderQueue& queue, RenderPass pass, const std::vector<StaticBatch>& batches, Model& batchModel, ShaderVariantCache& shaders);
+
+// Radix sort the submitted keys
+void SortRenderQueue(RenderQueue& queue);
+
+// True when the current context can execute a queue with indirect set
+bool IsMultiDrawIndirectSupported();
+
+// Draw the sorted commands of one pass. Shaders, materials, VAOs and object uniforms are only
+// rebound when they differ from the previous command. With indirect set, each run of commands
+// sharing that state is one glMultiDrawElementsIndirect.
+void ExecuteRenderQueue(RenderQueue& queue, RenderPass pass);
+
+// Release the indirect command buffer
+void ReleaseRenderQueue(RenderQueue& queue);
+
+#endif
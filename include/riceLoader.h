@@ -7,6 +7,8 @@
 #include <glm/glm.hpp>
 #include "shader.h"
 #include "camera.h"
+#include "vertexFormat.h"
+#include "normalGenerator.h"
 
 // Vertex structure: holds position, texture coordinates, and normal data
 struct Vertex {
@@ -17,14 +19,36 @@ struct Vertex {
 
 // Material structure: holds properties for lighting and texturing
 struct Material {
+    std::string name;       // Name from the MTL file
     glm::vec3 ambient;      // Ambient color
     glm::vec3 diffuse;      // Diffuse color
     glm::vec3 specular;     // Specular color
     float shininess;        // Shininess coefficient
     std::string texturePath; // Path to the texture
-    unsigned int textureID;  // OpenGL texture ID
-    unsigned int diffuseTexture; // ID for the diffuse texture
-    unsigned int specularTexture; // ID for the specular texture
+    std::string specularTexturePath; // map_Ks
+    std::string normalTexturePath;   // map_Bump, bump or norm
+    unsigned int textureID = 0;  // OpenGL texture ID
+    unsigned int diffuseTexture = 0; // ID for the diffuse texture, 0 when the material has none
+    unsigned int specularTexture = 0; // ID for the specular texture
+    unsigned int normalTexture = 0;   // ID for the tangent space normal map
+};
+
+// One level of detail: a range of the mesh's index buffer and its geometric error
+struct MeshLod {
+    unsigned int indexOffset; // First index in the EBO
+    unsigned int indexCount;  // Number of indices
+    float error;              // Object space error relative to the full detail mesh
+};
+
+// A cluster of at most 64 vertices and 124 triangles with culling bounds
+struct Meshlet {
+    unsigned int indexOffset; // First index in Mesh::indices; meshlets are consecutive runs of the full detail level
+    unsigned int indexCount;  // Three indices per triangle
+    unsigned int vertexCount; // Unique vertices referenced
+    glm::vec3 center;         // Bounding sphere in object space
+    float radius;
+    glm::vec3 coneAxis;       // Average facing direction of the triangles
+    float coneCutoff;         // Sine of the cone spread; 1 when the cluster can't be back-face culled
 };
 
 // Mesh structure: encapsulates vertices, indices, and material data
@@ -34,6 +58,63 @@ struct Mesh {
     Material material;       
     unsigned int vao; // Vertex Array Object
     unsigned int vbo; // Vertex Buffer Object// Material properties
+    VertexFormat format;             // GPU storage format of the vertices
+    VertexQuantization quantization; // Decode parameters for the normalized formats
+    unsigned int indexCount = 0;     // Number of indices in the EBO
+    unsigned int indexType = 0;      // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, chosen at upload
+    std::vector<MeshLod> lods;             // Levels of detail, lods[0] is the full mesh (empty when no chain was built)
+    std::vector<unsigned int> lodIndices;  // Indices of the coarser levels, uploaded after `indices`
+    glm::vec3 boundsCenter = glm::vec3(0.0f); // Bounding sphere center in object space
+    float boundsRadius = 0.0f;                // Bounding sphere radius in object space
+    std::vector<Meshlet> meshlets;            // Clusters of the full detail level (empty when not built)
+    unsigned int indexBase = 0;               // Position of indices in the EBO, set at upload
+    unsigned int baseVertex = 0;              // Position of the first vertex in the VBO, set at upload
+    std::vector<glm::vec4> tangents;          // Per-vertex tangent and bitangent sign (empty when not generated)
+};
+
+// Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER (GL 4.3)
+struct DrawElementsIndirectCommand {
+    unsigned int count;         // Number of indices
+    unsigned int instanceCount;
+    unsigned int firstIndex;    // In indices, not bytes
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
+// A range of a model's index buffer drawn with one material
+struct Submesh {
+    unsigned int indexOffset; // First index in the model's EBO
+    unsigned int indexCount;  // Number of full detail indices
+    unsigned int materialId;  // Index into Model::materials
+};
+
+struct GpuBufferPool;
+
+// Ranges of a GpuBufferPool arena holding one model
+struct GpuAllocation {
+    int arena = -1;           // Index into GpuBufferPool::arenas, -1 when not allocated
+    size_t vertexOffset = 0;  // In vertices
+    size_t vertexCount = 0;
+    size_t indexOffset = 0;   // In bytes
+    size_t indexBytes = 0;
+};
+
+// All geometry of a model file in one VAO, VBO and EBO, split into per-material submeshes.
+// submeshes[i] draws meshes[i]; the meshes keep their LODs and meshlets, addressed into the shared buffers.
+struct Model {
+    std::vector<Mesh> meshes;         // CPU data, one per "usemtl" group
+    std::vector<Material> materials;  // Unique materials by name
+    std::vector<Submesh> submeshes;
+    VertexFormat format;              // GPU storage format shared by every submesh
+    VertexQuantization quantization;  // Decode parameters over the whole model
+    unsigned int indexType = 0;       // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, chosen at upload
+    unsigned int vertexCount = 0;     // Vertices in the VBO, set at upload
+    bool hasTangents = false;         // The VBO ends with a tangent stream, set at upload
+    GpuBufferPool* pool = nullptr;    // Set when loaded into a pool: vao is then the arena's and vbo and ebo are 0
+    GpuAllocation allocation;         // Ranges of the pool's arena the model lives in
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    unsigned int ebo = 0;
 };
 
 // Function declarations
@@ -41,19 +122,102 @@ struct Mesh {
 // Load material data from a .mtl file
 void LoadMaterial(const std::string& filePath, std::unordered_map<std::string, Material>& materials);
 
-// Load model data from an .obj file into a vector of Mesh structs
-void LoadModel(const std::string& filePath, std::vector<Mesh>& meshes);
+// Load model data from an .obj file into a vector of indexed, triangulated Mesh structs.
+// Faces without "vn" normals get normals generated from their smoothing groups.
+void LoadModel(const std::string& filePath, std::vector<Mesh>& meshes,
+    const NormalGenerationOptions& normalOptions = NormalGenerationOptions());
+
+// Select the GPU vertex format of a mesh and compute its quantization bounds
+void SetMeshVertexFormat(Mesh& mesh, const VertexFormat& format);
+
+// Upload mesh data to GPU buffers, packed in the mesh's vertex format.
+// Tangents, when present, follow the vertices as an extra stream on attribute 3.
+// Indices are stored as 16 bit when the mesh has fewer than 65536 vertices.
+void LoadMeshToGPU(Mesh& mesh, unsigned int& vao, unsigned int& vbo, unsigned int& ebo);
+
+// Pick the coarsest level whose projected error stays below pixelError pixels
+unsigned int SelectMeshLod(
+    const Mesh& mesh, const glm::mat4& model, const Camera& camera,
+    const unsigned int SCR_HEIGHT, float pixelError = 1.0f);
+
+// Perspective projection of the camera, shared by every pass
+glm::mat4 ProjectionMatrix(const Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT);
+
+// Bind a material's textures and set its uniforms on the shader in use
+void BindMaterial(Shader& shader, const Material& material);
 
-// Upload mesh data to GPU buffers
-void LoadMeshToGPU(const Mesh& mesh, unsigned int& vao, unsigned int& vbo, unsigned int& ebo);
+// Issue the draw of one level of a mesh through the bound VAO.
+// Level 0 of a mesh with meshlets is frustum and cone culled per meshlet.
+void DrawMeshElements(
+    const Mesh& mesh, unsigned int level,
+    const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+
+// Append the ranges DrawMeshElements would draw as indirect commands instead of drawing them
+void AppendMeshDrawCommands(
+    const Mesh& mesh, unsigned int level,
+    const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+    std::vector<DrawElementsIndirectCommand>& commands);
+
+// Upload the camera, projection and light to the FrameData uniform block. Call once per frame before drawing;
+// the draw functions below only write their per-object block. Also resets the GL state cache and its stats.
+void BeginFrame(
+    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT,
+    glm::vec3 lightPos, glm::vec3 lightColor);
 
 // Draw a mesh using its associated VAO and shader
 void Draw(
     unsigned int& vao, Shader& shader, Mesh& mesh, Material& material,
-    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT,
-    glm::vec3 lightPos, glm::vec3 lightColor);
+    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time);
+
+// Draw a mesh into the depth buffer only, using just its position attribute
+void DrawDepth(
+    unsigned int& vao, Shader& depthShader, Mesh& mesh,
+    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time);
 
 // Release GPU resources for a mesh
 void Unload(unsigned int& vao, unsigned int& vbo, unsigned int& ebo);
 
+// Gather processed meshes into a model and assign material ids by material name
+void BuildModel(std::vector<Mesh> meshes, Model& model);
+
+// Select the GPU vertex format of a model and compute its quantization bounds over every mesh
+void SetModelVertexFormat(Model& model, const VertexFormat& format);
+
+// Upload every mesh of a model into one VBO and one EBO behind a single VAO.
+// Indices stay relative to each mesh and are drawn with a base vertex, so they are 16 bit
+// whenever every mesh has fewer than 65536 vertices.
+void LoadModelToGPU(Model& model);
+
+// Upload a model into ranges of the pool's shared buffers instead of buffers of its own.
+// model.vao is the arena's VAO, shared with every model of the same vertex format.
+bool LoadModelToGPU(Model& model, GpuBufferPool& pool);
+
+// Move a pooled model's base vertices and index offsets to a new allocation of the same sizes
+void RelocateModel(Model& model, const GpuAllocation& allocation);
+
+// Point attributes 0-3 of the bound VAO at the model's VBO, as LoadModelToGPU does for model.vao
+void SetupModelAttributes(const Model& model);
+
+// Draw every submesh with its material, binding the model's VAO once
+void DrawModel(
+    Model& model, Shader& shader, Camera& camera,
+    const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time);
+
+// Draw every submesh into the depth buffer only
+void DrawModelDepth(
+    Model& model, Shader& depthShader, Camera& camera,
+    const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time);
+
+// Draw every submesh at full detail with explicit matrices, for offscreen passes such as impostor baking.
+// materialShaders[i] draws the submeshes of model.materials[i]. Overwrites the FrameData block.
+void DrawModelView(
+    Model& model, const std::vector<Shader*>& materialShaders,
+    const glm::mat4& view, const glm::mat4& projection, const glm::mat4& modelMatrix);
+
+// Model matrix the viewer animates meshes with, shared by every pass so they agree on depth
+glm::mat4 MeshModelMatrix(float time);
+
+// Release the GPU resources of a model, or return its ranges to the pool it was loaded into
+void UnloadModel(Model& model);
+
 #endif
@@ -8,14 +8,64 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <filesystem>
+#include <cstdint>
+#include <cstdio>
+
+#include "glState.h"
+
+// Process-wide id for a uniform name. Create one per name (usually as a static) and pass it to the
+// setters: each Shader maps ids to its own locations, so per-frame updates are a plain array lookup.
+class UniformHandle
+{
+public:
+    explicit UniformHandle(const std::string& name) : index(registerName(name)) {}
+
+    unsigned int index;
+
+    // Names of every handle created so far, indexed by handle
+    static const std::vector<std::string>& names() { return registry().names; }
+
+private:
+    struct Registry
+    {
+        std::vector<std::string> names;
+        std::unordered_map<std::string, unsigned int> indices;
+    };
+
+    static Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    static unsigned int registerName(const std::string& name)
+    {
+        Registry& r = registry();
+        auto found = r.indices.find(name);
+        if (found != r.indices.end())
+            return found->second;
+        r.names.push_back(name);
+        return r.indices[name] = static_cast<unsigned int>(r.names.size() - 1);
+    }
+};
 
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor submits the compile and link and returns without waiting for them: errors are reported
+    // and uniforms looked up on first use, so many shaders build at once (on driver threads where
+    // GL_KHR_parallel_shader_compile is available) while the caller loads models.
+    // With binaryCacheDir set, linked programs are saved there and later launches load them instead of
+    // compiling, as long as the sources and the driver are the same.
+    // defines are added as "#define NAME" lines after the #version line of both stages.
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* binaryCacheDir = nullptr,
+        const std::vector<std::string>& defines = {})
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -38,107 +88,394 @@ public:
             vShaderFile.close();
             fShaderFile.close();
             // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            vertexCode = injectDefines(vShaderStream.str(), defines);
+            fragmentCode = injectDefines(fShaderStream.str(), defines);
         }
         catch (std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
+        // 2. load the linked program from the binary cache
+        std::string cachePath;
+        uint64_t cacheKey = 0;
+        if (binaryCacheDir && programBinarySupported())
+        {
+            cacheKey = binaryCacheKey(vertexCode, fragmentCode);
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.glprog", static_cast<unsigned long long>(cacheKey));
+            cachePath = (std::filesystem::path(binaryCacheDir) / name).string();
+            if (loadProgramBinary(cachePath, cacheKey))
+            {
+                reflectUniforms();
+                return;
+            }
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
+        // 3. submit the compiles and the link; no status is queried until finish()
+        enableParallelCompile();
         // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vShaderCode, NULL);
+        glCompileShader(vertexShader);
         // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
+        glCompileShader(fragmentShader);
         // shader Program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
+        if (!cachePath.empty())
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(ID, vertexShader);
+        glAttachShader(ID, fragmentShader);
         glLinkProgram(ID);
+        // flag the shaders for deletion now; they live on while attached, so finish() can still read their logs
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        pendingCachePath = cachePath;
+        pendingCacheKey = cacheKey;
+        pending = true;
+    }
+    // true once the build has completed and finish() will not stall. Without parallel compile support
+    // the driver can't be asked, so this is always true and finish() waits for whatever is left.
+    // ------------------------------------------------------------------------
+    bool isReady() const
+    {
+        if (!pending || !parallelCompileSupported())
+            return true;
+        GLint completed = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+    // wait for the build, report errors, save the binary and look up every active uniform once.
+    // use(), the setters and uniform lookups call this, so it only needs calling directly to choose when to wait.
+    // ------------------------------------------------------------------------
+    void finish() const
+    {
+        if (!pending)
+            return;
+        pending = false;
+        checkCompileErrors(vertexShader, "VERTEX");
+        checkCompileErrors(fragmentShader, "FRAGMENT");
         checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
+        if (!pendingCachePath.empty())
+            saveProgramBinary(pendingCachePath, pendingCacheKey);
+        reflectUniforms();
+        for (const auto& block : pendingBlocks)
+            bindUniformBlock(block.first, block.second);
+        pendingBlocks.clear();
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        finish();
+        CachedUseProgram(ID);
+    }
+    // location of a uniform from the table built at link time, -1 when it is not active
+    // ------------------------------------------------------------------------
+    int getUniformLocation(const std::string& name) const
+    {
+        finish();
+        auto found = uniformLocations.find(name);
+        return found != uniformLocations.end() ? found->second : -1;
+    }
+    int getUniformLocation(UniformHandle handle) const
+    {
+        // Handles created after the last lookup are resolved once and then served from the array
+        if (handle.index >= handleLocations.size())
+        {
+            const std::vector<std::string>& names = UniformHandle::names();
+            for (size_t i = handleLocations.size(); i < names.size(); ++i)
+                handleLocations.push_back(getUniformLocation(names[i]));
+        }
+        return handleLocations[handle.index];
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(getUniformLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(getUniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getUniformLocation(name), 1, &value[0]);
     }
     void setVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // point a uniform block at a buffer binding point; programs without the block are left alone
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const std::string& blockName, unsigned int binding) const
+    {
+        // querying the block of a program still linking would wait for it, so the binding is applied by finish()
+        if (pending)
+        {
+            pendingBlocks.emplace_back(blockName, binding);
+            return;
+        }
+        GLuint blockIndex = glGetUniformBlockIndex(ID, blockName.c_str());
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, blockIndex, binding);
+    }
+    // the same setters by handle, for per-frame updates
+    // ------------------------------------------------------------------------
+    void setBool(UniformHandle handle, bool value) const
+    {
+        glUniform1i(getUniformLocation(handle), (int)value);
+    }
+    void setInt(UniformHandle handle, int value) const
+    {
+        glUniform1i(getUniformLocation(handle), value);
+    }
+    void setFloat(UniformHandle handle, float value) const
+    {
+        glUniform1f(getUniformLocation(handle), value);
+    }
+    void setVec2(UniformHandle handle, const glm::vec2& value) const
+    {
+        glUniform2fv(getUniformLocation(handle), 1, &value[0]);
+    }
+    void setVec3(UniformHandle handle, const glm::vec3& value) const
+    {
+        glUniform3fv(getUniformLocation(handle), 1, &value[0]);
+    }
+    void setVec4(UniformHandle handle, const glm::vec4& value) const
+    {
+        glUniform4fv(getUniformLocation(handle), 1, &value[0]);
+    }
+    void setMat3(UniformHandle handle, const glm::mat3& mat) const
+    {
+        glUniformMatrix3fv(getUniformLocation(handle), 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(UniformHandle handle, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(getUniformLocation(handle), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    mutable std::unordered_map<std::string, int> uniformLocations;  // active uniforms by name
+    mutable std::vector<int> handleLocations;                       // locations by UniformHandle::index
+
+    // build submitted by the constructor and not checked yet, completed by finish()
+    mutable bool pending = false;
+    unsigned int vertexShader = 0;
+    unsigned int fragmentShader = 0;
+    std::string pendingCachePath;
+    uint64_t pendingCacheKey = 0;
+    mutable std::vector<std::pair<std::string, unsigned int>> pendingBlocks;
+
+    // GL 4.6 core has no parallel compile; it comes from the KHR extension or the ARB one it was promoted from
+    // ------------------------------------------------------------------------
+    static bool parallelCompileSupported()
+    {
+        return GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+    }
+    // let the driver use as many compiler threads as it likes; set once, before the first compile
+    // ------------------------------------------------------------------------
+    static void enableParallelCompile()
+    {
+        static bool enabled = false;
+        if (enabled)
+            return;
+        enabled = true;
+        if (GLAD_GL_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        else if (GLAD_GL_ARB_parallel_shader_compile)
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+    }
+
+    // GLSL wants #version first, so the defines go right after it
+    // ------------------------------------------------------------------------
+    static std::string injectDefines(const std::string& code, const std::vector<std::string>& defines)
+    {
+        if (defines.empty())
+            return code;
+        std::string block;
+        for (const std::string& define : defines)
+            block += "#define " + define + "\n";
+        size_t version = code.find("#version");
+        if (version == std::string::npos)
+            return block + code;
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return code + "\n" + block;
+        return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+    }
+    // program binaries need GL 4.1 or ARB_get_program_binary, and a driver that offers at least one format
+    // ------------------------------------------------------------------------
+    static bool programBinarySupported()
+    {
+        if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+    // FNV-1a over the sources and the driver strings; binaries are only valid for the driver that made them
+    // ------------------------------------------------------------------------
+    static uint64_t binaryCacheKey(const std::string& vertexCode, const std::string& fragmentCode)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const char* text)
+        {
+            for (const char* c = text ? text : ""; ; ++c)
+            {
+                hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ull;
+                if (*c == '\0')
+                    break; // the terminator separates the strings
+            }
+        };
+        mix(vertexCode.c_str());
+        mix(fragmentCode.c_str());
+        mix(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+        mix(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        mix(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+        return hash;
+    }
+    // cache file: "RLPB", version, key, binary format, binary length, binary
+    // ------------------------------------------------------------------------
+    bool loadProgramBinary(const std::string& path, uint64_t key)
+    {
+        std::ifstream file(path, std::ios::binary);
+        char magic[4] = {};
+        uint32_t version = 0, format = 0, length = 0;
+        uint64_t storedKey = 0;
+        file.read(magic, 4);
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+        file.read(reinterpret_cast<char*>(&format), sizeof(format));
+        file.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!file || std::string(magic, 4) != "RLPB" || version != 1 || storedKey != key || length == 0)
+            return false;
+        std::vector<char> binary(length);
+        if (!file.read(binary.data(), length))
+            return false;
+
+        // the driver may still refuse a binary (for example after an update it didn't report in its strings)
+        ID = glCreateProgram();
+        glProgramBinary(ID, format, binary.data(), static_cast<GLsizei>(length));
+        GLint success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(ID);
+            ID = 0;
+            return false;
+        }
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void saveProgramBinary(const std::string& path, uint64_t key) const
+    {
+        GLint success = 0, length = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!success || length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+        std::ofstream file(path, std::ios::binary);
+        uint32_t version = 1, storedFormat = format, storedLength = static_cast<uint32_t>(length);
+        file.write("RLPB", 4);
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        file.write(reinterpret_cast<const char*>(&storedFormat), sizeof(storedFormat));
+        file.write(reinterpret_cast<const char*>(&storedLength), sizeof(storedLength));
+        file.write(binary.data(), length);
+        if (!file)
+            std::cout << "ERROR::SHADER::BINARY_CACHE_NOT_WRITTEN: " << path << std::endl;
+    }
+    // fill the location table from the linked program's active uniforms
+    // ------------------------------------------------------------------------
+    void reflectUniforms() const
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            GLint location = glGetUniformLocation(ID, name.c_str());
+            if (location < 0)
+                continue; // members of uniform blocks have no location
+
+            // arrays are reported as "name[0]"; register the bare name and every element
+            size_t bracket = name.rfind("[0]");
+            if (bracket != std::string::npos && bracket + 3 == name.size())
+            {
+                std::string base = name.substr(0, bracket);
+                uniformLocations[base] = location;
+                for (GLint element = 0; element < size; ++element)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniformLocations[elementName] = glGetUniformLocation(ID, elementName.c_str());
+                }
+            }
+            else
+            {
+                uniformLocations[name] = location;
+            }
+        }
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static void checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
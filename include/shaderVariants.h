@@ -0,0 +1,50 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "shader.h"
+#include "riceLoader.h"
+
+// Compile-time features of default.vs and default.fs, each enabled by the #define of the same name
+enum ShaderFeature : unsigned int {
+    SHADER_FEATURE_DIFFUSE_MAP = 1u << 0,   // DIFFUSE_MAP: sample material.diffuse
+    SHADER_FEATURE_SPECULAR_MAP = 1u << 1,  // SPECULAR_MAP: sample material.specular
+    SHADER_FEATURE_NORMAL_MAP = 1u << 2,    // NORMAL_MAP: perturb the normal with material.normal and the tangent
+    SHADER_FEATURE_INSTANCING = 1u << 3     // INSTANCING: per-instance transform and tint on attributes 4-11
+};
+
+// Programs built from one vertex and fragment source pair, one per feature mask, submitted on first request
+struct ShaderVariantCache {
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string binaryCacheDir;  // Empty to always compile from source
+    std::unordered_map<unsigned int, std::unique_ptr<Shader>> variants;
+};
+
+// Set the sources of the cache; no program is compiled yet
+void InitShaderVariants(ShaderVariantCache& cache, const std::string& vertexPath, const std::string& fragmentPath, const std::string& binaryCacheDir = "");
+
+// The program for a feature mask, submitted for compiling the first time it is asked for.
+// Returns at once; the build is waited for when the shader is first used.
+Shader& GetShaderVariant(ShaderVariantCache& cache, unsigned int features);
+
+// Submit every listed variant up front so they compile together while the caller does other work
+void PrepareShaderVariants(ShaderVariantCache& cache, const std::vector<unsigned int>& featureMasks);
+
+// Number of submitted variants whose build has completed
+size_t ReadyShaderVariants(const ShaderVariantCache& cache);
+
+// The cheapest features that draw a material: only the maps it actually has a texture for. The normal
+// map also needs the mesh to have tangents, otherwise it is left out.
+unsigned int MaterialShaderFeatures(const Material& material, bool hasTangents);
+
+// #define names of a feature mask, in bit order
+std::vector<std::string> ShaderFeatureDefines(unsigned int features);
+
+// Delete every compiled variant
+void ReleaseShaderVariants(ShaderVariantCache& cache);
+
+#endif
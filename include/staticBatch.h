@@ -0,0 +1,58 @@
+#ifndef STATICBATCH_H
+#define STATICBATCH_H
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "riceLoader.h"
+
+// A static mesh placed in the scene
+struct StaticInstance {
+    const Mesh* mesh;                       // Source geometry, its full detail indices are used
+    glm::mat4 transform = glm::mat4(1.0f);  // Object to world
+    unsigned int materialId = 0;            // Instances only merge with others using the same material
+    unsigned int shaderId = 0;              // and the same shader
+};
+
+// Where one source instance ended up inside a batch
+struct BatchRange {
+    unsigned int source;      // Index into the instances given to BuildStaticBatches
+    unsigned int indexOffset; // First index in the batch mesh
+    unsigned int indexCount;  // Three indices per triangle
+    glm::vec3 center;         // Bounding sphere in world space
+    float radius;
+};
+
+// Geometry of small instances sharing a material and shader, merged and already in world space
+struct StaticBatch {
+    Mesh mesh;                      // Draw with an identity model matrix; may be moved into a Model for upload
+    unsigned int materialId;
+    unsigned int shaderId;
+    std::vector<BatchRange> ranges; // One per source, in index order
+};
+
+// Settings for static batching
+struct StaticBatchOptions {
+    size_t maxSourceVertices = 4096; // Larger meshes are not worth merging and stay unbatched
+    size_t maxBatchVertices = 65535; // A batch is closed before it outgrows 16 bit indices
+};
+
+// Pre-transform instances into merged batches, grouped by shader then material.
+// Instances whose meshes exceed maxSourceVertices are skipped and their indices appended to unbatched.
+std::vector<StaticBatch> BuildStaticBatches(
+    const std::vector<StaticInstance>& instances,
+    const StaticBatchOptions& options = StaticBatchOptions(),
+    std::vector<unsigned int>* unbatched = nullptr);
+
+// Append draw ranges (index counts, byte offsets into the EBO and base vertices) of the batch's sources
+// inside the frustum for glMultiDrawElementsBaseVertex, merging neighbouring visible sources into one draw.
+// uploaded is the batch mesh as placed in the GPU buffers, e.g. the Model mesh it was moved into, and
+// supplies the index base, index type and base vertex. Returns the number of sources culled.
+size_t CullStaticBatch(
+    const StaticBatch& batch, const Mesh& uploaded, const glm::mat4& viewProjection,
+    std::vector<int>& counts, std::vector<const void*>& offsets, std::vector<int>& baseVertices);
+
+// Source instance a triangle of the batch came from, for picking; -1 when out of range
+int FindBatchSource(const StaticBatch& batch, unsigned int triangle);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef TANGENTGENERATOR_H
+#define TANGENTGENERATOR_H
+
+struct Mesh;
+
+// Compute MikkTSpace tangents for normal mapping into mesh.tangents, following the reference
+// implementation with its default 180 degree threshold: w holds the bitangent sign so the shader
+// rebuilds it as sign * cross(normal, tangent). MikkTSpace gives each corner its own frame, so a
+// vertex whose corners end up with different frames (mirrored UVs, faces not connected through
+// the vertex's fan) is split and the extra copies are appended to mesh.vertices with the indices
+// updated. Run this before building LODs or meshlets. The result doesn't depend on the thread
+// count.
+void GenerateTangents(Mesh& mesh, unsigned int threads = 0);
+
+#endif
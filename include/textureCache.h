@@ -0,0 +1,82 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "riceLoader.h"
+
+// Where a cached texture is between the request and the finished upload
+enum class TextureState {
+    Decoding,   // Queued for or being decoded on a worker thread
+    Decoded,    // Pixels ready, waiting for an upload slot on the render thread
+    Uploading,  // Copied into a pixel buffer; the driver transfers it while the fence is unsignaled
+    Ready,
+    Failed      // The file could not be decoded; the placeholder stays
+};
+
+// One texture file, shared by everything that acquired its path
+struct CachedTexture {
+    std::string path;              // Resolved path, the cache key
+    unsigned int texture = 0;      // Created by the first acquire with a 1x1 placeholder, valid until the last release
+    unsigned int refCount = 0;
+    TextureState state = TextureState::Decoding;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;  // Written by a worker, freed once they are in the pixel buffer
+    unsigned int pixelBuffer = 0;
+    void* fence = nullptr;         // GLsync of the upload
+};
+
+// Textures keyed by resolved path. Files are decoded on worker threads and uploaded through pixel buffer
+// objects a few per frame, so the render thread never waits on a decode or a transfer. Handles are plain
+// GL texture names, usable as soon as they are acquired and counted per acquire.
+struct TextureCache {
+    std::unordered_map<std::string, std::shared_ptr<CachedTexture>> byPath;
+    std::unordered_map<unsigned int, std::shared_ptr<CachedTexture>> byTexture;
+    size_t uploadBytesPerFrame = 8 << 20;  // Decoded bytes copied into pixel buffers per UpdateTextureCache
+
+    // Shared with the workers, guarded by mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::shared_ptr<CachedTexture>> decodeQueue;
+    std::vector<std::shared_ptr<CachedTexture>> decoded;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+// Start the decode workers; 0 threads picks one less than the hardware threads, at least one
+void InitTextureCache(TextureCache& cache, unsigned int threads = 0);
+
+// The texture for a file, shared with earlier requests for the same resolved path. A new path is queued
+// for decoding and drawn with the placeholder color until its upload finishes. Returns 0 for an empty path.
+unsigned int AcquireTexture(TextureCache& cache, const std::string& path, const glm::vec4& placeholder = glm::vec4(1.0f));
+
+// Drop one reference; the texture is deleted with the last one
+void ReleaseTexture(TextureCache& cache, unsigned int texture);
+
+// Move decoded textures into pixel buffers within the frame's byte budget and finish the uploads whose
+// transfers completed. Call once per frame on the thread that owns the GL context.
+void UpdateTextureCache(TextureCache& cache);
+
+// Number of acquired textures not yet uploaded or failed
+size_t PendingTextures(TextureCache& cache);
+
+// Acquire the diffuse, specular and normal maps a material names, relative to directory
+void AcquireMaterialTextures(TextureCache& cache, Material& material, const std::string& directory);
+
+// Release the maps taken by AcquireMaterialTextures and clear them from the material
+void ReleaseMaterialTextures(TextureCache& cache, Material& material);
+
+// Stop the workers and delete every texture, whatever its reference count
+void ReleaseTextureCache(TextureCache& cache);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef UNIFORMBUFFERS_H
+#define UNIFORMBUFFERS_H
+
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "vertexFormat.h"
+
+// Uniform buffer binding points of the blocks shared by default.vs, default.fs and depth.vs
+const unsigned int FRAME_UNIFORM_BINDING = 0;
+const unsigned int OBJECT_UNIFORM_BINDING = 1;
+
+// std140 layout of the FrameData block: set once per frame
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 viewPos;    // xyz camera position
+    glm::vec4 lightPos;   // xyz light position
+    glm::vec4 lightColor; // rgb light color
+};
+
+// std140 layout of the ObjectData block: one slot per drawn object
+struct ObjectUniforms {
+    glm::mat4 model;
+    glm::mat4 normalMatrix;   // transpose(inverse(model)) in the upper 3x3, computed on the CPU
+    glm::vec4 positionOffset; // Vertex decode parameters: decoded = offset + scale * stored
+    glm::vec4 positionScale;
+    glm::vec4 texCoordDecode; // xy offset, zw scale
+    int octNormals;
+    int padding[3];
+};
+
+// Point a program's FrameData and ObjectData blocks at their binding points (blocks it lacks are skipped)
+void BindUniformBlocks(Shader& shader);
+
+// Upload the per-frame block and start a new frame of object slots.
+// The buffers are created on first use; the object buffer holds objectCapacity slots before it is orphaned.
+void SetFrameUniforms(
+    const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos,
+    const glm::vec3& lightPos, const glm::vec3& lightColor);
+
+// Write the next object slot and bind it to OBJECT_UNIFORM_BINDING by offset
+void SetObjectUniforms(const glm::mat4& model, const VertexFormat& format, const VertexQuantization& quantization);
+
+// Delete the uniform buffers
+void ReleaseUniformBuffers();
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+struct Vertex;
+
+// Storage format of the position attribute
+enum class PositionFormat {
+    Float32,   // 12 bytes
+    Half,      // 6 bytes, half floats normalized to the mesh bounds
+    Snorm16    // 6 bytes, normalized to the mesh bounds
+};
+
+// Storage format of the normal attribute
+enum class NormalFormat {
+    Float32,    // 12 bytes
+    OctSnorm16, // 4 bytes, octahedral encoding
+    OctSnorm8   // 2 bytes, octahedral encoding
+};
+
+// Storage format of the texture coordinate attribute
+enum class TexCoordFormat {
+    Float32,   // 8 bytes
+    Unorm16    // 4 bytes, normalized to the mesh UV bounds
+};
+
+// Selects how each vertex attribute is stored on the GPU
+struct VertexFormat {
+    PositionFormat position = PositionFormat::Float32;
+    NormalFormat normal = NormalFormat::Float32;
+    TexCoordFormat texCoord = TexCoordFormat::Float32;
+    bool splitPositions = false; // Store positions in their own stream ahead of the other attributes
+
+    // The original 32 byte float layout
+    static VertexFormat Full() { return VertexFormat(); }
+
+    // 16 bytes: half positions, unorm16 UVs, 16 bit octahedral normals
+    static VertexFormat Compact16() { return { PositionFormat::Half, NormalFormat::OctSnorm16, TexCoordFormat::Unorm16 }; }
+
+    // 12 bytes: snorm16 positions with the 8 bit octahedral normal in their fourth short, unorm16 UVs
+    static VertexFormat Compact12() { return { PositionFormat::Snorm16, NormalFormat::OctSnorm8, TexCoordFormat::Unorm16 }; }
+
+    // Same attribute formats with positions moved to their own stream
+    VertexFormat Split() const { VertexFormat format = *this; format.splitPositions = true; return format; }
+};
+
+// Dequantization parameters: decoded = offset + scale * stored
+struct VertexQuantization {
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec2 texCoordOffset = glm::vec2(0.0f);
+    glm::vec2 texCoordScale = glm::vec2(1.0f);
+};
+
+// Byte offsets of each attribute inside one packed vertex.
+// With split positions the position stream comes first, followed by the stream of the other attributes.
+struct VertexLayout {
+    size_t positionOffset;  // Offset inside the position stream
+    size_t texCoordOffset;  // Offset inside the attribute stream
+    size_t normalOffset;    // Offset inside the attribute stream, or the position stream with normalWithPosition
+    bool normalWithPosition; // An 8 bit octahedral normal fills the padding after a 16 bit position
+    size_t positionStride;  // Stride of the position stream (same as stride when interleaved)
+    size_t stride;          // Stride of the attribute stream
+    size_t bytesPerVertex;  // Total GPU bytes per vertex across streams
+};
+
+// Compute the packed layout of a format (attribute offsets and strides aligned to 4 bytes)
+VertexLayout GetVertexLayout(const VertexFormat& format);
+
+// Byte offset of the attribute stream inside a buffer packed by PackVertices
+size_t GetAttributeStreamOffset(const VertexFormat& format, size_t vertexCount);
+
+// Compute dequantization parameters from the vertex bounds for the normalized formats
+VertexQuantization ComputeVertexQuantization(const std::vector<Vertex>& vertices, const VertexFormat& format);
+
+// Encode vertices into a byte buffer matching GetVertexLayout
+std::vector<unsigned char> PackVertices(const std::vector<Vertex>& vertices, const VertexFormat& format, const VertexQuantization& quantization);
+
+// Octahedral encoding of a unit vector into [-1, 1]^2
+glm::vec2 OctEncode(const glm::vec3& n);
+
+// Inverse of OctEncode, returning a unit vector
+glm::vec3 OctDecode(const glm::vec2& e);
+
+// Set up attribute pointers 0 (position), 1 (texcoord) and 2 (normal) for the bound VAO and VBO
+void SetupVertexAttributes(const VertexFormat& format, size_t vertexCount);
+
+// Bytes per vertex of the optional tangent stream (snorm16 xyzw)
+const size_t TANGENT_STREAM_STRIDE = 4 * sizeof(short);
+
+// Encode tangents (xyz, w bitangent sign) into a stream of TANGENT_STREAM_STRIDE bytes per vertex
+std::vector<unsigned char> PackTangents(const std::vector<glm::vec4>& tangents);
+
+// Set up attribute pointer 3 (tangent) for a stream packed by PackTangents at byteOffset in the bound VBO
+void SetupTangentAttribute(size_t byteOffset);
+
+#endif
@@ -1,37 +1,77 @@
 #version 330 core
 
+// Feature defines are inserted after the version line (ShaderFeature in shaderVariants.h)
+
 struct Material {
-    sampler2D diffuse;  // Diffuse texture
-    sampler2D specular; // Specular texture
-    float shininess;    // Shininess factor
+#ifdef DIFFUSE_MAP
+    sampler2D diffuse;   // Diffuse texture, multiplied by diffuseColor
+#endif
+#ifdef SPECULAR_MAP
+    sampler2D specular;  // Specular texture, multiplied by specularColor
+#endif
+#ifdef NORMAL_MAP
+    sampler2D normal;    // Tangent space normal map
+#endif
+    vec3 diffuseColor;   // Kd
+    vec3 specularColor;  // Ks
+    float shininess;     // Shininess factor
 };
 
 in vec3 FragPos;      // World position of the fragment
 in vec3 Normal;       // Interpolated normal vector
 in vec2 TexCoord;     // Interpolated texture coordinates
+in vec4 Tangent;      // Interpolated tangent, bitangent = Tangent.w * cross(Normal, Tangent.xyz)
+in vec4 Tint;         // Per-instance color multiplier
 
 out vec4 FragColor;
 
-uniform vec3 lightPos;     // Light source position
-uniform vec3 viewPos;      // Camera/view position
-uniform vec3 lightColor;   // Light color
+// Set once per frame (FrameUniforms in uniformBuffers.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
 uniform Material material; // Material properties
 
 void main() {
+    vec3 albedo = material.diffuseColor * Tint.rgb;
+#ifdef DIFFUSE_MAP
+    albedo *= texture(material.diffuse, TexCoord).rgb;
+#endif
+    vec3 specularColor = material.specularColor;
+#ifdef SPECULAR_MAP
+    specularColor *= texture(material.specular, TexCoord).rgb;
+#endif
+
+    vec3 norm = normalize(Normal);
+#ifdef NORMAL_MAP
+    // Gram-Schmidt the interpolated tangent against the normal, then move the sampled normal to world space.
+    // A missing or degenerate tangent leaves the normal unmapped instead of normalizing zero.
+    vec3 tangent = Tangent.xyz - norm * dot(norm, Tangent.xyz);
+    if (dot(tangent, tangent) > 1e-8) {
+        tangent = normalize(tangent);
+        vec3 bitangent = Tangent.w * cross(norm, tangent);
+        vec3 mapped = texture(material.normal, TexCoord).xyz * 2.0 - 1.0;
+        norm = normalize(mat3(tangent, bitangent, norm) * mapped);
+    }
+#endif
+
     // Ambient lighting
-    vec3 ambient = 0.1 * lightColor;
+    vec3 ambient = 0.1 * lightColor.rgb;
 
     // Diffuse lighting
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor * texture(material.diffuse, TexCoord).rgb;
+    vec3 diffuse = diff * lightColor.rgb * albedo;
 
     // Specular lighting
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = spec * lightColor * texture(material.specular, TexCoord).rgb;
+    vec3 specular = spec * lightColor.rgb * specularColor;
 
     // Combine lighting components
     vec3 result = ambient + diffuse + specular;
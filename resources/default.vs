@@ -1,22 +1,73 @@
 #version 330 core
 
-layout(location = 0) in vec3 aPos;       // Vertex position
-layout(location = 1) in vec2 aTexCoord;  // Texture coordinate
-layout(location = 2) in vec3 aNormal;    // Normal vector
+// Feature defines are inserted after the version line (ShaderFeature in shaderVariants.h)
+
+layout(location = 0) in vec3 aPos;       // Vertex position (possibly normalized to the mesh bounds)
+layout(location = 1) in vec2 aTexCoord;  // Texture coordinate (possibly normalized to the mesh UV bounds)
+layout(location = 2) in vec3 aNormal;    // Normal vector, or octahedral xy when octNormals is set
+layout(location = 3) in vec4 aTangent;   // Tangent and bitangent sign, (0, 0, 0, 1) when the mesh has none
+
+#ifdef INSTANCING
+// Per-instance attributes (InstanceBatch in instancing.h), advanced once per instance
+layout(location = 4) in mat4 aInstanceModel;   // Locations 4-7
+layout(location = 8) in mat3 aInstanceNormal;  // Locations 8-10, transpose(inverse(aInstanceModel))
+layout(location = 11) in vec4 aInstanceTint;
+#endif
 
 out vec3 FragPos;       // To pass world position to fragment shader
 out vec3 Normal;        // To pass normals to fragment shader
 out vec2 TexCoord;      // To pass texture coordinates
+out vec4 Tangent;       // World space tangent, w is the bitangent sign
+out vec4 Tint;          // Per-instance color multiplier, white without INSTANCING
+
+// Set once per frame (FrameUniforms in uniformBuffers.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Set per drawn object (ObjectUniforms in uniformBuffers.h)
+layout(std140) uniform ObjectData {
+    mat4 model;           // With INSTANCING, applied after each instance's own transform
+    mat4 normalMatrix;    // transpose(inverse(model)), computed on the CPU
+    vec4 positionOffset;  // Vertex decode parameters: decoded = offset + scale * stored
+    vec4 positionScale;
+    vec4 texCoordDecode;  // xy offset, zw scale
+    bool octNormals;
+};
+
+// Must match depth.vs exactly so the depth prepass and this pass agree on depth
+invariant gl_Position;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
 
 void main() {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal; // Transform normals correctly
-    TexCoord = aTexCoord;
+    vec3 position = positionOffset.xyz + positionScale.xyz * aPos;
+    vec3 normal = octNormals ? octDecode(aNormal.xy) : aNormal;
+
+#ifdef INSTANCING
+    mat4 world = model * aInstanceModel;
+    mat3 normalWorld = mat3(normalMatrix) * aInstanceNormal;
+    Tint = aInstanceTint;
+#else
+    mat4 world = model;
+    mat3 normalWorld = mat3(normalMatrix);
+    Tint = vec4(1.0);
+#endif
+
+    FragPos = vec3(world * vec4(position, 1.0));
+    Normal = normalWorld * normal;
+    TexCoord = texCoordDecode.xy + texCoordDecode.zw * aTexCoord;
+    Tangent = vec4(mat3(world) * aTangent.xyz, aTangent.w);
 
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
-
@@ -0,0 +1,5 @@
+#version 330 core
+
+// Depth-only pass: no color outputs, the rasterizer writes depth
+void main() {
+}
@@ -0,0 +1,32 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos; // Vertex position (possibly normalized to the mesh bounds)
+
+// Set once per frame (FrameUniforms in uniformBuffers.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
+// Set per drawn object (ObjectUniforms in uniformBuffers.h)
+layout(std140) uniform ObjectData {
+    mat4 model;
+    mat4 normalMatrix;    // transpose(inverse(model)), computed on the CPU
+    vec4 positionOffset;  // Vertex decode parameters: decoded = offset + scale * stored
+    vec4 positionScale;
+    vec4 texCoordDecode;  // xy offset, zw scale
+    bool octNormals;
+};
+
+// Must match default.vs exactly so the lighting pass can test with GL_LEQUAL
+invariant gl_Position;
+
+void main() {
+    vec3 position = positionOffset.xyz + positionScale.xyz * aPos;
+    vec3 fragPos = vec3(model * vec4(position, 1.0));
+
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+
+in vec3 FragPos;     // World position on the quad
+in vec2 AtlasCoord;  // Texture coordinate in the atlas
+
+out vec4 FragColor;
+
+uniform sampler2D albedoAtlas; // Baked diffuse color, alpha is coverage
+uniform sampler2D normalAtlas; // Baked object space normals
+uniform mat4 model;            // Rotation only, so it also transforms normals
+uniform vec3 lightPos;         // Light source position
+uniform vec3 lightColor;       // Light color
+
+void main() {
+    vec4 albedo = texture(albedoAtlas, AtlasCoord);
+    if (albedo.a < 0.5) {
+        discard;
+    }
+
+    // Ambient and diffuse lighting from the baked normals; specular is left out at impostor distances
+    vec3 ambient = 0.1 * lightColor;
+    vec3 norm = normalize(mat3(model) * (texture(normalAtlas, AtlasCoord).xyz * 2.0 - 1.0));
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor * albedo.rgb;
+
+    FragColor = vec4(ambient + diffuse, 1.0);
+}
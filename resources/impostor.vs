@@ -0,0 +1,51 @@
+#version 330 core
+
+layout(location = 0) in vec2 aCorner;  // Quad corner in [-1, 1]
+
+out vec3 FragPos;      // World position of the quad
+out vec2 AtlasCoord;   // Texture coordinate inside the chosen atlas frame
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform vec3 objectCameraPos; // Camera position in object space
+uniform vec3 center;          // Bounding sphere of the baked model
+uniform float radius;
+uniform float framesPerSide;  // Octahedral grid size of the atlas
+
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 p = n.xy;
+    if (n.z < 0.0) {
+        p = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return p;
+}
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    // Nearest baked view to the camera direction
+    vec3 toCamera = normalize(objectCameraPos - center);
+    vec2 frame = clamp(floor((octEncode(toCamera) * 0.5 + 0.5) * framesPerSide), 0.0, framesPerSide - 1.0);
+    vec3 frameDirection = octDecode((frame + 0.5) / framesPerSide * 2.0 - 1.0);
+
+    // Same basis as the bake camera (glm::lookAt) so the frame lines up with the quad
+    vec3 forward = -frameDirection;
+    vec3 upHint = abs(frameDirection.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 right = normalize(cross(forward, upHint));
+    vec3 up = cross(right, forward);
+
+    vec3 position = center + (right * aCorner.x + up * aCorner.y) * radius;
+    AtlasCoord = (frame + aCorner * 0.5 + 0.5) / framesPerSide;
+    FragPos = vec3(model * vec4(position, 1.0));
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
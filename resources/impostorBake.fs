@@ -0,0 +1,28 @@
+#version 330 core
+
+// Writes the impostor atlas, used with default.vs and an identity model matrix
+
+struct Material {
+#ifdef DIFFUSE_MAP
+    sampler2D diffuse;  // Diffuse texture
+#endif
+    vec3 diffuseColor;  // Kd, multiplies the diffuse texture
+};
+
+in vec3 FragPos;      // Object position of the fragment
+in vec3 Normal;       // Interpolated object space normal
+in vec2 TexCoord;     // Interpolated texture coordinates
+
+layout(location = 0) out vec4 Albedo;     // Diffuse color, alpha marks coverage
+layout(location = 1) out vec4 NormalOut;  // Normal packed into [0, 1]
+
+uniform Material material; // Material properties
+
+void main() {
+    vec3 albedo = material.diffuseColor;
+#ifdef DIFFUSE_MAP
+    albedo *= texture(material.diffuse, TexCoord).rgb;
+#endif
+    Albedo = vec4(albedo, 1.0);
+    NormalOut = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
@@ -8,11 +8,21 @@
 #include "shader.h"
 #include "camera.h"
 #include "riceLoader.h"
+#include "meshlets.h"
+#include "normalGenerator.h"
+#include "uniformBuffers.h"
+#include "gpuBuffers.h"
+#include "glState.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
 
 
@@ -39,6 +49,7 @@ void LoadMaterial(const std::string& filePath, std::unordered_map<std::string, M
             }
             lineStream >> currentMaterialName;
             currentMaterial = Material();
+            currentMaterial.name = currentMaterialName;
         }
         else if (token == "Ka") {
             lineStream >> currentMaterial.ambient.r >> currentMaterial.ambient.g >> currentMaterial.ambient.b;
@@ -55,6 +66,12 @@ void LoadMaterial(const std::string& filePath, std::unordered_map<std::string, M
         else if (token == "map_Kd") {
             lineStream >> currentMaterial.texturePath;
         }
+        else if (token == "map_Ks") {
+            lineStream >> currentMaterial.specularTexturePath;
+        }
+        else if (token == "map_Bump" || token == "bump" || token == "norm") {
+            lineStream >> currentMaterial.normalTexturePath;
+        }
     }
 
     if (!currentMaterialName.empty()) {
@@ -62,8 +79,109 @@ void LoadMaterial(const std::string& filePath, std::unordered_map<std::string, M
     }
 }
 
+// One corner of a parsed face: 1-based OBJ indices, 0 when the attribute is missing
+struct FaceCorner {
+    unsigned int pos, tex, norm;
+};
+
+// Resolve a (possibly negative, relative) OBJ index to 1-based, or 0 when it is out of range
+static unsigned int ResolveObjIndex(int index, size_t count) {
+    long long resolved = index < 0 ? static_cast<long long>(count) + index + 1 : index;
+    return resolved >= 1 && resolved <= static_cast<long long>(count) ? static_cast<unsigned int>(resolved) : 0;
+}
+
+// Parse "p", "p/t", "p//n" or "p/t/n"
+static bool ParseFaceCorner(const std::string& faceData, size_t positionCount, size_t texCoordCount, size_t normalCount, FaceCorner& corner) {
+    int p = 0, t = 0, n = 0;
+    if (std::sscanf(faceData.c_str(), "%d/%d/%d", &p, &t, &n) == 3) {}
+    else if (std::sscanf(faceData.c_str(), "%d//%d", &p, &n) == 2) { t = 0; }
+    else if (std::sscanf(faceData.c_str(), "%d/%d", &p, &t) == 2) { n = 0; }
+    else if (std::sscanf(faceData.c_str(), "%d", &p) == 1) { t = 0; n = 0; }
+    else {
+        return false;
+    }
+
+    corner.pos = ResolveObjIndex(p, positionCount);
+    corner.tex = t == 0 ? 0 : ResolveObjIndex(t, texCoordCount);
+    corner.norm = n == 0 ? 0 : ResolveObjIndex(n, normalCount);
+    return corner.pos != 0;
+}
+
+// Vertex identity used to share vertices between faces
+struct VertexKey {
+    unsigned int pos, tex;
+    glm::vec3 normal;
+
+    bool operator==(const VertexKey& other) const {
+        return pos == other.pos && tex == other.tex && std::memcmp(&normal, &other.normal, sizeof(normal)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& key) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &key.normal, sizeof(bits));
+        return (key.pos * 73856093u) ^ (key.tex * 19349663u) ^ (bits[0] * 83492791u) ^ (bits[1] * 2654435761u) ^ bits[2];
+    }
+};
+
+// Turn the triangulated face corners of one mesh into indexed vertices, generating missing normals
+static void BuildMeshVertices(
+    Mesh& mesh, const std::vector<FaceCorner>& corners, const std::vector<unsigned int>& smoothingGroups,
+    const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals,
+    const NormalGenerationOptions& normalOptions)
+{
+    bool needsNormals = false;
+    for (const FaceCorner& corner : corners) {
+        needsNormals = needsNormals || corner.norm == 0;
+    }
+
+    std::vector<glm::vec3> generatedNormals;
+    if (needsNormals) {
+        std::vector<unsigned int> cornerPositions(corners.size());
+        for (size_t c = 0; c < corners.size(); ++c) {
+            cornerPositions[c] = corners[c].pos - 1;
+        }
+        generatedNormals = GenerateCornerNormals(positions, cornerPositions, smoothingGroups, normalOptions);
+    }
+
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> vertexLookup;
+    vertexLookup.reserve(corners.size());
+    mesh.indices.reserve(corners.size());
+
+    for (size_t c = 0; c < corners.size(); ++c) {
+        const FaceCorner& corner = corners[c];
+        VertexKey key = { corner.pos, corner.tex, corner.norm != 0 ? normals[corner.norm - 1] : generatedNormals[c] };
+
+        // Reuse the vertex if this position/texcoord/normal was already emitted
+        auto found = vertexLookup.find(key);
+        if (found != vertexLookup.end()) {
+            mesh.indices.push_back(found->second);
+            continue;
+        }
+
+        Vertex vertex;
+        vertex.x = positions[corner.pos - 1].x;
+        vertex.y = positions[corner.pos - 1].y;
+        vertex.z = positions[corner.pos - 1].z;
+
+        glm::vec2 texCoord = corner.tex != 0 ? texCoords[corner.tex - 1] : glm::vec2(0.0f);
+        vertex.tx = texCoord.x;
+        vertex.ty = texCoord.y;
+
+        vertex.nx = key.normal.x;
+        vertex.ny = key.normal.y;
+        vertex.nz = key.normal.z;
+
+        mesh.vertices.push_back(vertex);
+        unsigned int index = static_cast<unsigned int>(mesh.vertices.size() - 1);
+        vertexLookup.emplace(key, index);
+        mesh.indices.push_back(index);
+    }
+}
+
 // Parse OBJ file and load meshes
-void LoadModel(const std::string& filePath, std::vector<Mesh>& meshes) {
+void LoadModel(const std::string& filePath, std::vector<Mesh>& meshes, const NormalGenerationOptions& normalOptions) {
     std::ifstream objFile(filePath);
     if (!objFile.is_open()) {
         std::cerr << "Error: Could not open OBJ file " << filePath << std::endl;
@@ -75,9 +193,26 @@ void LoadModel(const std::string& filePath, std::vector<Mesh>& meshes) {
     std::vector<glm::vec3> normals;
     std::unordered_map<std::string, Material> materials;
 
-    Mesh currentMesh;
+    // Faces of the current mesh, triangulated, with one smoothing group per triangle
+    std::vector<FaceCorner> corners;
+    std::vector<unsigned int> smoothingGroups;
+    unsigned int currentSmoothingGroup = 1; // Files without "s" statements are smoothed as a whole
+    size_t skippedFaces = 0;
+
+    Mesh currentMesh = Mesh(); // Value-initialized so meshes without "usemtl" get a zeroed material
     std::string line, currentMaterialName;
 
+    auto flushMesh = [&]() {
+        if (corners.empty()) {
+            return;
+        }
+        BuildMeshVertices(currentMesh, corners, smoothingGroups, positions, texCoords, normals, normalOptions);
+        meshes.push_back(currentMesh);
+        currentMesh = Mesh();
+        corners.clear();
+        smoothingGroups.clear();
+    };
+
     while (std::getline(objFile, line)) {
         std::istringstream lineStream(line);
         std::string token;
@@ -99,35 +234,38 @@ void LoadModel(const std::string& filePath, std::vector<Mesh>& meshes) {
             normals.push_back(normal);
         }
         else if (token == "f") {
-            unsigned int posIdx, texIdx, normIdx;
             std::string faceData;
+            std::vector<FaceCorner> face;
+            bool valid = true;
 
             while (lineStream >> faceData) {
-                if (std::sscanf(faceData.c_str(), "%u/%u/%u", &posIdx, &texIdx, &normIdx) == 3) {
-                    Vertex vertex;
-                    vertex.x = positions[posIdx - 1].x;
-                    vertex.y = positions[posIdx - 1].y;
-                    vertex.z = positions[posIdx - 1].z;
-
-                    vertex.tx = texCoords[texIdx - 1].x;
-                    vertex.ty = texCoords[texIdx - 1].y;
-
-                    vertex.nx = normals[normIdx - 1].x;
-                    vertex.ny = normals[normIdx - 1].y;
-                    vertex.nz = normals[normIdx - 1].z;
-
-                    currentMesh.vertices.push_back(vertex);
-                    currentMesh.indices.push_back(static_cast<unsigned int>(currentMesh.vertices.size() - 1));
-                }
+                FaceCorner corner;
+                valid = valid && ParseFaceCorner(faceData, positions.size(), texCoords.size(), normals.size(), corner);
+                face.push_back(corner);
+            }
+            if (!valid) {
+                skippedFaces++;
+                continue;
+            }
+
+            // Triangulate the polygon as a fan around its first corner
+            for (size_t i = 1; i + 1 < face.size(); ++i) {
+                corners.push_back(face[0]);
+                corners.push_back(face[i]);
+                corners.push_back(face[i + 1]);
+                smoothingGroups.push_back(currentSmoothingGroup);
             }
         }
+        else if (token == "s") {
+            std::string group;
+            lineStream >> group;
+            currentSmoothingGroup = (group == "off") ? SMOOTHING_GROUP_OFF : static_cast<unsigned int>(std::strtoul(group.c_str(), nullptr, 10));
+        }
         else if (token == "usemtl") {
-            if (!currentMesh.vertices.empty()) {
-                meshes.push_back(currentMesh);
-                currentMesh = Mesh();
-            }
+            flushMesh();
             lineStream >> currentMaterialName;
             currentMesh.material = materials[currentMaterialName];
+            currentMesh.material.name = currentMaterialName;
         }
         else if (token == "mtllib") {
             std::string mtlFile;
@@ -136,86 +274,276 @@ void LoadModel(const std::string& filePath, std::vector<Mesh>& meshes) {
         }
     }
 
-    if (!currentMesh.vertices.empty()) {
-        meshes.push_back(currentMesh);
+    flushMesh();
+
+    if (skippedFaces > 0) {
+        std::cerr << "Warning: Skipped " << skippedFaces << " faces with invalid indices in " << filePath << std::endl;
     }
 }
 
+// Choose how the mesh is stored on the GPU
+void SetMeshVertexFormat(Mesh& mesh, const VertexFormat& format) {
+    mesh.format = format;
+    mesh.quantization = ComputeVertexQuantization(mesh.vertices, format);
+}
+
+// Encode indices in the smallest type that can address every vertex
+static std::vector<unsigned char> PackIndices(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int& indexType) {
+    std::vector<unsigned char> packed;
+    if (vertexCount < 65536) {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        packed.resize(shortIndices.size() * sizeof(uint16_t));
+        std::memcpy(packed.data(), shortIndices.data(), packed.size());
+        indexType = GL_UNSIGNED_SHORT;
+        return packed;
+    }
+
+    packed.resize(indices.size() * sizeof(unsigned int));
+    std::memcpy(packed.data(), indices.data(), packed.size());
+    indexType = GL_UNSIGNED_INT;
+    return packed;
+}
+
+// Upload indices to the bound EBO in the smallest type that can address every vertex
+static unsigned int UploadIndices(const std::vector<unsigned int>& indices, size_t vertexCount) {
+    unsigned int indexType;
+    std::vector<unsigned char> packed = PackIndices(indices, vertexCount, indexType);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+    return indexType;
+}
+
+// Upload vertices (and tangents when present) to the bound VBO and set up the bound VAO's attributes
+static void UploadVertices(
+    const std::vector<Vertex>& vertices, const std::vector<glm::vec4>& tangents,
+    const VertexFormat& format, const VertexQuantization& quantization)
+{
+    std::vector<unsigned char> packed = PackVertices(vertices, format, quantization);
+    size_t tangentStream = packed.size();
+    bool hasTangents = !tangents.empty() && tangents.size() == vertices.size();
+    if (hasTangents) {
+        std::vector<unsigned char> packedTangents = PackTangents(tangents);
+        packed.insert(packed.end(), packedTangents.begin(), packedTangents.end());
+    }
+    glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+    SetupVertexAttributes(format, vertices.size());
+    if (hasTangents) {
+        SetupTangentAttribute(tangentStream);
+    }
+}
+
+// Append the full detail and LOD indices of a mesh to an EBO's contents and record where they start
+static void AppendMeshIndices(Mesh& mesh, std::vector<unsigned int>& allIndices) {
+    mesh.indexBase = static_cast<unsigned int>(allIndices.size());
+    mesh.indexCount = static_cast<unsigned int>(mesh.indices.size());
+    allIndices.insert(allIndices.end(), mesh.indices.begin(), mesh.indices.end());
+    allIndices.insert(allIndices.end(), mesh.lodIndices.begin(), mesh.lodIndices.end());
+}
+
 // Bind mesh data to GPU
-void LoadMeshToGPU(const Mesh& mesh, unsigned int& vao, unsigned int& vbo, unsigned int& ebo) {
+void LoadMeshToGPU(Mesh& mesh, unsigned int& vao, unsigned int& vbo, unsigned int& ebo) {
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
     glGenBuffers(1, &ebo);
 
-    glBindVertexArray(vao);
+    CachedBindVertexArray(vao);
+
+    CachedBindBuffer(GL_ARRAY_BUFFER, vbo);
+    UploadVertices(mesh.vertices, mesh.tangents, mesh.format, mesh.quantization);
+
+    // All levels of detail share one index buffer, full detail first; meshlets are ranges of it
+    std::vector<unsigned int> allIndices;
+    mesh.baseVertex = 0;
+    AppendMeshIndices(mesh, allIndices);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STATIC_DRAW);
+    CachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    mesh.indexType = UploadIndices(allIndices, mesh.vertices.size());
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+    CachedBindVertexArray(0);
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
+// Select a level of detail from the projected screen-space error
+unsigned int SelectMeshLod(
+    const Mesh& mesh, const glm::mat4& model, const Camera& camera,
+    const unsigned int SCR_HEIGHT, float pixelError)
+{
+    if (mesh.lods.size() < 2) {
+        return 0;
+    }
 
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, tx)));
-    glEnableVertexAttribArray(1);
+    glm::vec3 center = glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f));
+    float distance = std::max(glm::length(center - camera.Position) - mesh.boundsRadius, 0.1f);
 
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex, nx)));
-    glEnableVertexAttribArray(2);
+    // Pixels per world unit at that distance
+    float pixelsPerUnit = static_cast<float>(SCR_HEIGHT) / (2.0f * std::tan(glm::radians(camera.Zoom) * 0.5f) * distance);
 
-    glBindVertexArray(0);
+    unsigned int level = 0;
+    for (unsigned int i = 1; i < mesh.lods.size(); ++i) {
+        if (mesh.lods[i].error * pixelsPerUnit > pixelError) {
+            break;
+        }
+        level = i;
+    }
+    return level;
 }
 
-// Render the mesh
-void Draw(
-    unsigned int& vao, Shader& shader, Mesh& mesh, Material& material,
-    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT,
-    glm::vec3 lightPos, glm::vec3 lightColor)
+// Draw the mesh's index range for the selected level of detail.
+// At full detail, meshlets that are off-screen or facing away are skipped.
+void DrawMeshElements(
+    const Mesh& mesh, unsigned int level,
+    const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
 {
-    // Use the shader program
-    shader.use();
+    if (level == 0 && !mesh.meshlets.empty()) {
+        static std::vector<GLsizei> counts;
+        static std::vector<const void*> offsets;
+        counts.clear();
+        offsets.clear();
+        CullMeshlets(mesh, model, viewProjection, cameraPosition, counts, offsets);
+        if (!counts.empty()) {
+            static std::vector<GLint> baseVertices;
+            baseVertices.assign(counts.size(), static_cast<GLint>(mesh.baseVertex));
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), mesh.indexType, offsets.data(),
+                static_cast<GLsizei>(counts.size()), baseVertices.data());
+        }
+        return;
+    }
+
+    unsigned int first = 0, count = mesh.indexCount;
+    if (level < mesh.lods.size()) {
+        first = mesh.lods[level].indexOffset;
+        count = mesh.lods[level].indexCount;
+    }
+
+    size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(count), mesh.indexType,
+        (void*)((mesh.indexBase + first) * indexSize), static_cast<GLint>(mesh.baseVertex));
+}
 
-    // Set view matrix from camera
-    glm::mat4 view = camera.GetViewMatrix();
-    shader.setMat4("view", view);
+// Same ranges as DrawMeshElements, recorded for a multi-draw indirect submission
+void AppendMeshDrawCommands(
+    const Mesh& mesh, unsigned int level,
+    const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+    std::vector<DrawElementsIndirectCommand>& commands)
+{
+    size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    int baseVertex = static_cast<int>(mesh.baseVertex);
+
+    if (level == 0 && !mesh.meshlets.empty()) {
+        static std::vector<GLsizei> counts;
+        static std::vector<const void*> offsets;
+        counts.clear();
+        offsets.clear();
+        CullMeshlets(mesh, model, viewProjection, cameraPosition, counts, offsets);
+        for (size_t i = 0; i < counts.size(); ++i) {
+            unsigned int firstIndex = static_cast<unsigned int>(reinterpret_cast<uintptr_t>(offsets[i]) / indexSize);
+            commands.push_back({ static_cast<unsigned int>(counts[i]), 1, firstIndex, baseVertex, 0 });
+        }
+        return;
+    }
+
+    unsigned int first = 0, count = mesh.indexCount;
+    if (level < mesh.lods.size()) {
+        first = mesh.lods[level].indexOffset;
+        count = mesh.lods[level].indexCount;
+    }
+    commands.push_back({ count, 1, mesh.indexBase + first, baseVertex, 0 });
+}
+
+// Model matrix shared by the depth and lighting passes so both produce identical depth
+glm::mat4 MeshModelMatrix(float time)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::rotate(model, time, glm::vec3(0.0f, 1.0f, 0.0f)); // Continuous rotation
+    return model;
+}
 
-    // Set projection matrix (Perspective Projection)
-    glm::mat4 projection = glm::perspective(
+// Projection matrix shared by every pass
+glm::mat4 ProjectionMatrix(const Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT)
+{
+    return glm::perspective(
         glm::radians(camera.Zoom), // Field of view
         static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT), // Aspect ratio
         0.1f, // Near clipping plane
         100.0f // Far clipping plane
     );
-    shader.setMat4("projection", projection);
+}
 
-    // Set model matrix (Positioning, Scaling, Rotation)
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::rotate(model, static_cast<float>(glfwGetTime()), glm::vec3(0.0f, 1.0f, 0.0f)); // Continuous rotation
-    shader.setMat4("model", model);
+// Material uniforms set on every draw, resolved to locations once per shader
+static const UniformHandle kMaterialDiffuseUniform("material.diffuse");
+static const UniformHandle kMaterialSpecularUniform("material.specular");
+static const UniformHandle kMaterialNormalUniform("material.normal");
+static const UniformHandle kMaterialDiffuseColorUniform("material.diffuseColor");
+static const UniformHandle kMaterialSpecularColorUniform("material.specularColor");
+static const UniformHandle kMaterialShininessUniform("material.shininess");
+
+// Upload the view, projection, camera and light shared by every draw of the frame
+void BeginFrame(
+    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT,
+    glm::vec3 lightPos, glm::vec3 lightColor)
+{
+    // ImGui and anything else outside the state cache ran since the last frame
+    InvalidateGLState();
+    ResetGLStateStats();
+    SetFrameUniforms(camera.GetViewMatrix(), ProjectionMatrix(camera, SCR_WIDTH, SCR_HEIGHT), camera.Position, lightPos, lightColor);
+}
+
+// Bind a material's textures and set its uniforms
+void BindMaterial(Shader& shader, const Material& material)
+{
+    // Variants without a map have no sampler for it, so only the maps the material has are bound
+    if (material.diffuseTexture != 0) {
+        CachedBindTexture(0, GL_TEXTURE_2D, material.diffuseTexture);
+        shader.setInt(kMaterialDiffuseUniform, 0);
+    }
+    if (material.specularTexture != 0) {
+        CachedBindTexture(1, GL_TEXTURE_2D, material.specularTexture);
+        shader.setInt(kMaterialSpecularUniform, 1);
+    }
+    if (material.normalTexture != 0) {
+        CachedBindTexture(2, GL_TEXTURE_2D, material.normalTexture);
+        shader.setInt(kMaterialNormalUniform, 2);
+    }
 
-    // Set light properties
-    shader.setVec3("lightPos", lightPos);
-    shader.setVec3("lightColor", lightColor);
+    shader.setVec3(kMaterialDiffuseColorUniform, material.diffuse);
+    shader.setVec3(kMaterialSpecularColorUniform, material.specular);
+    shader.setFloat(kMaterialShininessUniform, material.shininess);
+}
 
-    // Set camera position
-    shader.setVec3("viewPos", camera.Position);
+// Render the mesh
+void Draw(
+    unsigned int& vao, Shader& shader, Mesh& mesh, Material& material,
+    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time)
+{
+    // Use the shader program
+    shader.use();
+
+    // View, projection and light come from the frame block set by BeginFrame
+    glm::mat4 projection = ProjectionMatrix(camera, SCR_WIDTH, SCR_HEIGHT);
+    glm::mat4 model = MeshModelMatrix(time);
+    SetObjectUniforms(model, mesh.format, mesh.quantization);
 
     // Bind material properties
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, material.diffuseTexture);
-    shader.setInt("material.diffuse", 0);
+    BindMaterial(shader, material);
+
+    // Bind the VAO and draw the object; it stays bound so the next draw of the same VAO costs nothing
+    CachedBindVertexArray(vao);
+    DrawMeshElements(mesh, SelectMeshLod(mesh, model, camera, SCR_HEIGHT), model, projection * camera.GetViewMatrix(), camera.Position);
+}
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, material.specularTexture);
-    shader.setInt("material.specular", 1);
+// Render the mesh into the depth buffer only
+void DrawDepth(
+    unsigned int& vao, Shader& depthShader, Mesh& mesh,
+    Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time)
+{
+    depthShader.use();
 
-    shader.setFloat("material.shininess", material.shininess);
+    glm::mat4 projection = ProjectionMatrix(camera, SCR_WIDTH, SCR_HEIGHT);
+    glm::mat4 model = MeshModelMatrix(time);
+    SetObjectUniforms(model, mesh.format, mesh.quantization);
 
-    // Bind the VAO and draw the object
-    glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(mesh.vertices.size()));
-    glBindVertexArray(0); // Unbind the VAO (good practice)
+    // depth.vs only consumes attribute 0, so with split positions only the position stream is fetched
+    CachedBindVertexArray(vao);
+    DrawMeshElements(mesh, SelectMeshLod(mesh, model, camera, SCR_HEIGHT), model, projection * camera.GetViewMatrix(), camera.Position);
 }
 
 
@@ -224,9 +552,270 @@ void Unload(unsigned int& vao, unsigned int& vbo, unsigned int& ebo) {
     glDeleteVertexArrays(1, &vao);
     glDeleteBuffers(1, &vbo);
     glDeleteBuffers(1, &ebo);
+    InvalidateGLState(); // The deleted names may still be shadowed as bound
 
     vao = 0;
     vbo = 0;
     ebo = 0;
 }
 
+// Collect meshes into a model; meshes using the same material name share a material id
+void BuildModel(std::vector<Mesh> meshes, Model& model) {
+    model.meshes = std::move(meshes);
+    model.materials.clear();
+    model.submeshes.clear();
+
+    std::unordered_map<std::string, unsigned int> materialIds;
+    for (const Mesh& mesh : model.meshes) {
+        auto found = materialIds.find(mesh.material.name);
+        if (found == materialIds.end()) {
+            found = materialIds.emplace(mesh.material.name, static_cast<unsigned int>(model.materials.size())).first;
+            model.materials.push_back(mesh.material);
+        }
+
+        Submesh submesh;
+        submesh.indexOffset = 0;
+        submesh.indexCount = static_cast<unsigned int>(mesh.indices.size());
+        submesh.materialId = found->second;
+        model.submeshes.push_back(submesh);
+    }
+}
+
+// Choose one storage format for the whole model
+void SetModelVertexFormat(Model& model, const VertexFormat& format) {
+    std::vector<Vertex> allVertices;
+    for (const Mesh& mesh : model.meshes) {
+        allVertices.insert(allVertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    }
+
+    model.format = format;
+    model.quantization = ComputeVertexQuantization(allVertices, format);
+    for (Mesh& mesh : model.meshes) {
+        mesh.format = model.format;
+        mesh.quantization = model.quantization;
+    }
+}
+
+// Concatenate every mesh of a model, recording each mesh's base vertex and index ranges from zero
+static void GatherModelGeometry(
+    Model& model, std::vector<Vertex>& allVertices, std::vector<glm::vec4>& allTangents,
+    std::vector<unsigned int>& allIndices, bool& hasTangents, size_t& largestMesh)
+{
+    // Tangents are uploaded when any mesh has them; meshes without get a neutral frame
+    hasTangents = false;
+    largestMesh = 0;
+    for (const Mesh& mesh : model.meshes) {
+        hasTangents = hasTangents || !mesh.tangents.empty();
+    }
+
+    for (size_t i = 0; i < model.meshes.size(); ++i) {
+        Mesh& mesh = model.meshes[i];
+        mesh.baseVertex = static_cast<unsigned int>(allVertices.size());
+        allVertices.insert(allVertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        if (hasTangents) {
+            if (mesh.tangents.size() == mesh.vertices.size()) {
+                allTangents.insert(allTangents.end(), mesh.tangents.begin(), mesh.tangents.end());
+            }
+            else {
+                allTangents.resize(allVertices.size(), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+            }
+        }
+
+        AppendMeshIndices(mesh, allIndices);
+        model.submeshes[i].indexOffset = mesh.indexBase;
+        largestMesh = std::max(largestMesh, mesh.vertices.size());
+    }
+}
+
+// Bind all of a model's meshes to one set of GPU buffers
+void LoadModelToGPU(Model& model) {
+    std::vector<Vertex> allVertices;
+    std::vector<glm::vec4> allTangents;
+    std::vector<unsigned int> allIndices;
+    bool hasTangents;
+    size_t largestMesh;
+    GatherModelGeometry(model, allVertices, allTangents, allIndices, hasTangents, largestMesh);
+
+    glGenVertexArrays(1, &model.vao);
+    glGenBuffers(1, &model.vbo);
+    glGenBuffers(1, &model.ebo);
+
+    CachedBindVertexArray(model.vao);
+
+    CachedBindBuffer(GL_ARRAY_BUFFER, model.vbo);
+    UploadVertices(allVertices, allTangents, model.format, model.quantization);
+    model.vertexCount = static_cast<unsigned int>(allVertices.size());
+    model.hasTangents = hasTangents;
+
+    // Indices are relative to each mesh's base vertex, so only the largest mesh decides the index size
+    CachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.ebo);
+    model.indexType = UploadIndices(allIndices, largestMesh);
+    for (Mesh& mesh : model.meshes) {
+        mesh.indexType = model.indexType;
+        mesh.vao = model.vao;
+        mesh.vbo = model.vbo;
+    }
+
+    CachedBindVertexArray(0);
+}
+
+// Place all of a model's meshes in one vertex range and one index range of a shared arena
+bool LoadModelToGPU(Model& model, GpuBufferPool& pool) {
+    std::vector<Vertex> allVertices;
+    std::vector<glm::vec4> allTangents;
+    std::vector<unsigned int> allIndices;
+    bool hasTangents;
+    size_t largestMesh;
+    GatherModelGeometry(model, allVertices, allTangents, allIndices, hasTangents, largestMesh);
+    if (allVertices.empty() || allIndices.empty()) {
+        std::cerr << "Error: Model has no geometry to upload" << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> packed = PackVertices(allVertices, model.format, model.quantization);
+    if (hasTangents) {
+        std::vector<unsigned char> packedTangents = PackTangents(allTangents);
+        packed.insert(packed.end(), packedTangents.begin(), packedTangents.end());
+    }
+    std::vector<unsigned char> packedIndices = PackIndices(allIndices, largestMesh, model.indexType);
+
+    int arena = AcquireMeshArena(pool, model.format, hasTangents);
+    GpuAllocation allocation;
+    if (!AllocateMeshArenaRanges(pool, arena, allVertices.size(), packedIndices.size(), allocation)) {
+        return false;
+    }
+    WriteMeshArenaVertices(pool.arenas[arena], allocation, packed);
+    WriteMeshArenaIndices(pool.arenas[arena], allocation, packedIndices.data(), packedIndices.size());
+
+    model.pool = &pool;
+    model.vao = pool.arenas[arena].vao;
+    model.vbo = 0;
+    model.ebo = 0;
+    model.vertexCount = static_cast<unsigned int>(allVertices.size());
+    model.hasTangents = hasTangents;
+    for (Mesh& mesh : model.meshes) {
+        mesh.indexType = model.indexType;
+        mesh.vao = model.vao;
+        mesh.vbo = 0;
+    }
+
+    // The ranges were gathered as if the model started at zero; shift them onto the allocation
+    model.allocation = GpuAllocation();
+    model.allocation.arena = arena;
+    RelocateModel(model, allocation);
+    return true;
+}
+
+void RelocateModel(Model& model, const GpuAllocation& allocation) {
+    long long indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    long long vertexShift = static_cast<long long>(allocation.vertexOffset) - static_cast<long long>(model.allocation.vertexOffset);
+    long long indexShift = (static_cast<long long>(allocation.indexOffset) - static_cast<long long>(model.allocation.indexOffset)) / indexSize;
+
+    for (size_t i = 0; i < model.meshes.size(); ++i) {
+        Mesh& mesh = model.meshes[i];
+        mesh.baseVertex = static_cast<unsigned int>(mesh.baseVertex + vertexShift);
+        mesh.indexBase = static_cast<unsigned int>(mesh.indexBase + indexShift);
+        model.submeshes[i].indexOffset = mesh.indexBase;
+    }
+    model.allocation = allocation;
+}
+
+// Set up another VAO over the model's vertex streams
+void SetupModelAttributes(const Model& model) {
+    if (model.pool) {
+        SetupMeshArenaAttributes(model.pool->arenas[model.allocation.arena]);
+        return;
+    }
+    CachedBindBuffer(GL_ARRAY_BUFFER, model.vbo);
+    SetupVertexAttributes(model.format, model.vertexCount);
+    if (model.hasTangents) {
+        SetupTangentAttribute(GetAttributeStreamOffset(model.format, model.vertexCount) + model.vertexCount * GetVertexLayout(model.format).stride);
+    }
+    CachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model.ebo);
+}
+
+// Render every submesh of the model with one VAO bind
+void DrawModel(
+    Model& model, Shader& shader, Camera& camera,
+    const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time)
+{
+    shader.use();
+
+    glm::mat4 projection = ProjectionMatrix(camera, SCR_WIDTH, SCR_HEIGHT);
+    glm::mat4 modelMatrix = MeshModelMatrix(time);
+    glm::mat4 viewProjection = projection * camera.GetViewMatrix();
+    SetObjectUniforms(modelMatrix, model.format, model.quantization); // One object slot shared by every submesh
+
+    CachedBindVertexArray(model.vao);
+    unsigned int boundMaterial = static_cast<unsigned int>(-1);
+    for (size_t i = 0; i < model.submeshes.size(); ++i) {
+        const Submesh& submesh = model.submeshes[i];
+        if (submesh.materialId != boundMaterial) {
+            BindMaterial(shader, model.materials[submesh.materialId]);
+            boundMaterial = submesh.materialId;
+        }
+
+        const Mesh& mesh = model.meshes[i];
+        DrawMeshElements(mesh, SelectMeshLod(mesh, modelMatrix, camera, SCR_HEIGHT), modelMatrix, viewProjection, camera.Position);
+    }
+}
+
+// Render every submesh of the model into the depth buffer only
+void DrawModelDepth(
+    Model& model, Shader& depthShader, Camera& camera,
+    const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT, float time)
+{
+    depthShader.use();
+
+    glm::mat4 projection = ProjectionMatrix(camera, SCR_WIDTH, SCR_HEIGHT);
+    glm::mat4 modelMatrix = MeshModelMatrix(time);
+    glm::mat4 viewProjection = projection * camera.GetViewMatrix();
+    SetObjectUniforms(modelMatrix, model.format, model.quantization);
+
+    // Materials don't matter for depth, so the submeshes are drawn back to back
+    CachedBindVertexArray(model.vao);
+    for (const Mesh& mesh : model.meshes) {
+        DrawMeshElements(mesh, SelectMeshLod(mesh, modelMatrix, camera, SCR_HEIGHT), modelMatrix, viewProjection, camera.Position);
+    }
+}
+
+// Render every submesh at full detail without LOD selection or culling
+void DrawModelView(
+    Model& model, const std::vector<Shader*>& materialShaders,
+    const glm::mat4& view, const glm::mat4& projection, const glm::mat4& modelMatrix)
+{
+    // Offscreen views replace the frame block; the next BeginFrame restores the camera's
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    SetFrameUniforms(view, projection, eye, glm::vec3(0.0f), glm::vec3(0.0f));
+    SetObjectUniforms(modelMatrix, model.format, model.quantization);
+
+    CachedBindVertexArray(model.vao);
+    for (size_t i = 0; i < model.submeshes.size(); ++i) {
+        const Submesh& submesh = model.submeshes[i];
+        const Mesh& mesh = model.meshes[i];
+        Shader& shader = *materialShaders[submesh.materialId];
+        shader.use();
+        BindMaterial(shader, model.materials[submesh.materialId]);
+
+        size_t indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(submesh.indexCount), model.indexType,
+            (void*)(submesh.indexOffset * indexSize), static_cast<GLint>(mesh.baseVertex));
+    }
+}
+
+// Free a model's shared buffers
+void UnloadModel(Model& model) {
+    if (model.pool) {
+        // The arena's buffers stay for other models; only the ranges go back
+        FreeMeshArenaRanges(*model.pool, model.allocation);
+        model.pool = nullptr;
+        model.vao = 0;
+    }
+    else {
+        Unload(model.vao, model.vbo, model.ebo);
+    }
+    for (Mesh& mesh : model.meshes) {
+        mesh.vao = 0;
+        mesh.vbo = 0;
+    }
+}
@@ -0,0 +1,170 @@
+#include <glad/glad.h>
+#include <cstdint>
+#include <unordered_map>
+#include "glState.h"
+
+namespace {
+
+// Value of a shadow slot whose real state is not known
+const unsigned int kUnknown = ~0u;
+
+struct IndexedBinding {
+    unsigned int buffer = kUnknown;
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+struct GLStateCache {
+    unsigned int program = kUnknown;
+    unsigned int vao = kUnknown;
+    unsigned int activeUnit = kUnknown;
+    std::unordered_map<unsigned int, unsigned int> buffers;   // target -> buffer
+    std::unordered_map<uint64_t, IndexedBinding> indexedBuffers; // target << 32 | index -> range
+    std::unordered_map<uint64_t, unsigned int> textures;      // unit << 32 | target -> texture
+    std::unordered_map<unsigned int, bool> capabilities;
+    unsigned int depthMask = kUnknown;
+    unsigned int depthFunc = kUnknown;
+    unsigned int colorMask = kUnknown;
+    GLStateStats stats;
+};
+
+GLStateCache& Cache() {
+    static GLStateCache cache;
+    return cache;
+}
+
+// Store value in the slot and return true when the call has to be issued
+bool Update(unsigned int& slot, unsigned int value) {
+    GLStateCache& cache = Cache();
+    if (slot == value) {
+        cache.stats.skipped++;
+        return false;
+    }
+    slot = value;
+    cache.stats.issued++;
+    return true;
+}
+
+// Shared by the Base and Range variants; size 0 stands for the whole buffer
+bool UpdateIndexed(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) {
+    GLStateCache& cache = Cache();
+    IndexedBinding& slot = cache.indexedBuffers[(uint64_t(target) << 32) | index];
+    if (slot.buffer == buffer && slot.offset == offset && slot.size == size) {
+        cache.stats.skipped++;
+        return false;
+    }
+    slot = { buffer, offset, size };
+    cache.buffers[target] = buffer;
+    cache.stats.issued++;
+    return true;
+}
+
+} // namespace
+
+void CachedUseProgram(unsigned int program) {
+    if (Update(Cache().program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void CachedBindVertexArray(unsigned int vao) {
+    if (Update(Cache().vao, vao)) {
+        glBindVertexArray(vao);
+    }
+}
+
+void CachedBindBuffer(unsigned int target, unsigned int buffer) {
+    if (target == GL_ELEMENT_ARRAY_BUFFER) {
+        Cache().stats.issued++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    auto slot = Cache().buffers.emplace(target, kUnknown).first;
+    if (Update(slot->second, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void CachedBindBufferBase(unsigned int target, unsigned int index, unsigned int buffer) {
+    if (UpdateIndexed(target, index, buffer, 0, 0)) {
+        glBindBufferBase(target, index, buffer);
+    }
+}
+
+void CachedBindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size) {
+    if (UpdateIndexed(target, index, buffer, offset, size)) {
+        glBindBufferRange(target, index, buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+    }
+}
+
+void CachedBindTexture(unsigned int unit, unsigned int target, unsigned int texture) {
+    GLStateCache& cache = Cache();
+    auto slot = cache.textures.emplace((uint64_t(unit) << 32) | target, kUnknown).first;
+    if (slot->second == texture) {
+        cache.stats.skipped++;
+        return;
+    }
+    if (Update(cache.activeUnit, unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    slot->second = texture;
+    cache.stats.issued++;
+    glBindTexture(target, texture);
+}
+
+void CachedEnable(unsigned int capability) {
+    GLStateCache& cache = Cache();
+    auto slot = cache.capabilities.find(capability);
+    if (slot != cache.capabilities.end() && slot->second) {
+        cache.stats.skipped++;
+        return;
+    }
+    cache.capabilities[capability] = true;
+    cache.stats.issued++;
+    glEnable(capability);
+}
+
+void CachedDisable(unsigned int capability) {
+    GLStateCache& cache = Cache();
+    auto slot = cache.capabilities.find(capability);
+    if (slot != cache.capabilities.end() && !slot->second) {
+        cache.stats.skipped++;
+        return;
+    }
+    cache.capabilities[capability] = false;
+    cache.stats.issued++;
+    glDisable(capability);
+}
+
+void CachedDepthMask(bool write) {
+    if (Update(Cache().depthMask, write ? 1u : 0u)) {
+        glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+}
+
+void CachedDepthFunc(unsigned int func) {
+    if (Update(Cache().depthFunc, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void CachedColorMask(bool write) {
+    if (Update(Cache().colorMask, write ? 1u : 0u)) {
+        GLboolean value = write ? GL_TRUE : GL_FALSE;
+        glColorMask(value, value, value, value);
+    }
+}
+
+void InvalidateGLState() {
+    GLStateStats stats = Cache().stats;
+    Cache() = GLStateCache();
+    Cache().stats = stats;
+}
+
+const GLStateStats& GetGLStateStats() {
+    return Cache().stats;
+}
+
+void ResetGLStateStats() {
+    Cache().stats = GLStateStats();
+}
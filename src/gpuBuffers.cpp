@@ -0,0 +1,378 @@
+#include <glad/glad.h>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <iterator>
+#include "gpuBuffers.h"
+#include "glState.h"
+
+namespace {
+
+// Index ranges start on 4 bytes so either index type can be drawn from them
+const size_t kIndexAlignment = 4;
+
+struct RangeMove {
+    size_t from;
+    size_t to;
+    size_t size;
+};
+
+void InsertFree(RangeAllocator& allocator, size_t offset, size_t size) {
+    allocator.freeByOffset[offset] = size;
+    allocator.freeBySize.emplace(size, offset);
+}
+
+void EraseFree(RangeAllocator& allocator, std::map<size_t, size_t>::iterator it) {
+    auto range = allocator.freeBySize.equal_range(it->second);
+    for (auto bySize = range.first; bySize != range.second; ++bySize) {
+        if (bySize->second == it->first) {
+            allocator.freeBySize.erase(bySize);
+            break;
+        }
+    }
+    allocator.freeByOffset.erase(it);
+}
+
+// Pack the live ranges to the front in offset order and return where each one went
+std::vector<RangeMove> CompactRanges(RangeAllocator& allocator) {
+    std::vector<RangeMove> moves;
+    std::map<size_t, size_t> packed;
+    size_t cursor = 0;
+    for (const auto& allocation : allocator.allocations) {
+        moves.push_back({ allocation.first, cursor, allocation.second });
+        packed[cursor] = allocation.second;
+        cursor += allocation.second;
+    }
+
+    allocator.allocations.swap(packed);
+    allocator.freeByOffset.clear();
+    allocator.freeBySize.clear();
+    if (cursor < allocator.capacity) {
+        InsertFree(allocator, cursor, allocator.capacity - cursor);
+    }
+    return moves;
+}
+
+// Size of the free range ending at the capacity, which growing extends
+size_t TrailingFree(const RangeAllocator& allocator) {
+    if (allocator.freeByOffset.empty()) {
+        return 0;
+    }
+    auto last = std::prev(allocator.freeByOffset.end());
+    return last->first + last->second == allocator.capacity ? last->second : 0;
+}
+
+bool SameFormat(const VertexFormat& a, const VertexFormat& b) {
+    return a.position == b.position && a.normal == b.normal && a.texCoord == b.texCoord && a.splitPositions == b.splitPositions;
+}
+
+// Bytes per vertex of each stream of the arena's VBO, in buffer order
+std::vector<size_t> StreamStrides(const MeshArena& arena) {
+    VertexLayout layout = GetVertexLayout(arena.format);
+    std::vector<size_t> strides;
+    if (arena.format.splitPositions) {
+        strides.push_back(layout.positionStride);
+    }
+    strides.push_back(layout.stride);
+    if (arena.hasTangents) {
+        strides.push_back(TANGENT_STREAM_STRIDE);
+    }
+    return strides;
+}
+
+size_t VertexBytes(const MeshArena& arena) {
+    size_t bytes = 0;
+    for (size_t stride : StreamStrides(arena)) {
+        bytes += stride;
+    }
+    return bytes;
+}
+
+// Replace the arena's buffers with ones of the given capacities, copying each moved range across.
+// Vertex moves are in vertices and applied to every stream; index moves are in bytes.
+void RebuildMeshArena(
+    MeshArena& arena, size_t vertexCapacity, size_t indexCapacity,
+    const std::vector<RangeMove>& vertexMoves, const std::vector<RangeMove>& indexMoves)
+{
+    std::vector<size_t> strides = StreamStrides(arena);
+    size_t oldVertexCapacity = arena.vertices.capacity;
+
+    unsigned int vbo, ebo;
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * VertexBytes(arena), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, arena.vbo);
+    size_t oldStream = 0, newStream = 0;
+    for (size_t stride : strides) {
+        for (const RangeMove& move : vertexMoves) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                oldStream + move.from * stride, newStream + move.to * stride, move.size * stride);
+        }
+        oldStream += oldVertexCapacity * stride;
+        newStream += vertexCapacity * stride;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, arena.ebo);
+    for (const RangeMove& move : indexMoves) {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, move.from, move.to, move.size);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &arena.vbo);
+    glDeleteBuffers(1, &arena.ebo);
+    InvalidateGLState(); // The deleted names may still be shadowed as bound
+    arena.vbo = vbo;
+    arena.ebo = ebo;
+    GrowRangeAllocator(arena.vertices, vertexCapacity);
+    GrowRangeAllocator(arena.indices, indexCapacity);
+
+    // Stream offsets depend on the capacity, so the shared VAO is re-pointed rather than replaced
+    CachedBindVertexArray(arena.vao);
+    SetupMeshArenaAttributes(arena);
+    CachedBindVertexArray(0);
+}
+
+// Double the full side of the arena until the request fits, keeping every range where it is
+void GrowMeshArena(MeshArena& arena, size_t vertexCount, size_t indexBytes) {
+    size_t vertexCapacity = arena.vertices.capacity;
+    if (LargestFreeRange(arena.vertices) < vertexCount) {
+        while (TrailingFree(arena.vertices) + (vertexCapacity - arena.vertices.capacity) < vertexCount) {
+            vertexCapacity *= 2;
+        }
+    }
+    size_t indexCapacity = arena.indices.capacity;
+    if (LargestFreeRange(arena.indices) < indexBytes) {
+        while (TrailingFree(arena.indices) + (indexCapacity - arena.indices.capacity) < indexBytes) {
+            indexCapacity *= 2;
+        }
+    }
+
+    std::vector<RangeMove> vertexMoves, indexMoves;
+    if (arena.vertices.capacity > 0) {
+        vertexMoves.push_back({ 0, 0, arena.vertices.capacity });
+    }
+    if (arena.indices.capacity > 0) {
+        indexMoves.push_back({ 0, 0, arena.indices.capacity });
+    }
+    RebuildMeshArena(arena, vertexCapacity, indexCapacity, vertexMoves, indexMoves);
+}
+
+} // namespace
+
+void InitRangeAllocator(RangeAllocator& allocator, size_t capacity) {
+    allocator = RangeAllocator();
+    allocator.capacity = capacity;
+    if (capacity > 0) {
+        InsertFree(allocator, 0, capacity);
+    }
+}
+
+bool AllocateRange(RangeAllocator& allocator, size_t size, size_t& offset) {
+    auto fit = allocator.freeBySize.lower_bound(size);
+    if (size == 0 || fit == allocator.freeBySize.end()) {
+        return false;
+    }
+
+    size_t freeSize = fit->first;
+    offset = fit->second;
+    allocator.freeBySize.erase(fit);
+    allocator.freeByOffset.erase(offset);
+    if (freeSize > size) {
+        InsertFree(allocator, offset + size, freeSize - size);
+    }
+    allocator.allocations[offset] = size;
+    allocator.used += size;
+    return true;
+}
+
+void FreeRange(RangeAllocator& allocator, size_t offset) {
+    auto allocation = allocator.allocations.find(offset);
+    if (allocation == allocator.allocations.end()) {
+        std::cerr << "Error: Freeing a range that was not allocated at offset " << offset << std::endl;
+        return;
+    }
+    size_t size = allocation->second;
+    allocator.used -= size;
+    allocator.allocations.erase(allocation);
+
+    auto next = allocator.freeByOffset.find(offset + size);
+    if (next != allocator.freeByOffset.end()) {
+        size += next->second;
+        EraseFree(allocator, next);
+    }
+    auto previous = allocator.freeByOffset.lower_bound(offset);
+    if (previous != allocator.freeByOffset.begin()) {
+        --previous;
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            EraseFree(allocator, previous);
+        }
+    }
+    InsertFree(allocator, offset, size);
+}
+
+void GrowRangeAllocator(RangeAllocator& allocator, size_t capacity) {
+    if (capacity <= allocator.capacity) {
+        return;
+    }
+    size_t offset = allocator.capacity, size = capacity - allocator.capacity;
+    allocator.capacity = capacity;
+
+    // Merge with a free range that ended at the old capacity
+    if (!allocator.freeByOffset.empty()) {
+        auto last = std::prev(allocator.freeByOffset.end());
+        if (last->first + last->second == offset) {
+            offset = last->first;
+            size += last->second;
+            EraseFree(allocator, last);
+        }
+    }
+    InsertFree(allocator, offset, size);
+}
+
+size_t LargestFreeRange(const RangeAllocator& allocator) {
+    return allocator.freeBySize.empty() ? 0 : allocator.freeBySize.rbegin()->first;
+}
+
+int AcquireMeshArena(GpuBufferPool& pool, const VertexFormat& format, bool hasTangents) {
+    for (size_t i = 0; i < pool.arenas.size(); ++i) {
+        if (SameFormat(pool.arenas[i].format, format) && pool.arenas[i].hasTangents == hasTangents) {
+            return static_cast<int>(i);
+        }
+    }
+
+    MeshArena arena;
+    arena.format = format;
+    arena.hasTangents = hasTangents;
+    glGenVertexArrays(1, &arena.vao);
+    glGenBuffers(1, &arena.vbo);
+    glGenBuffers(1, &arena.ebo);
+
+    size_t indexCapacity = (pool.initialIndexBytes + kIndexAlignment - 1) / kIndexAlignment * kIndexAlignment;
+    InitRangeAllocator(arena.vertices, std::max<size_t>(pool.initialVertices, 1));
+    InitRangeAllocator(arena.indices, std::max(indexCapacity, kIndexAlignment));
+    CachedBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+    glBufferData(GL_ARRAY_BUFFER, arena.vertices.capacity * VertexBytes(arena), nullptr, GL_STATIC_DRAW);
+    CachedBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena.ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, arena.indices.capacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    CachedBindVertexArray(arena.vao);
+    SetupMeshArenaAttributes(arena);
+    CachedBindVertexArray(0);
+
+    pool.arenas.push_back(arena);
+    return static_cast<int>(pool.arenas.size() - 1);
+}
+
+bool AllocateMeshArenaRanges(GpuBufferPool& pool, int arenaIndex, size_t vertexCount, size_t indexBytes, GpuAllocation& allocation) {
+    if (arenaIndex < 0 || arenaIndex >= static_cast<int>(pool.arenas.size()) || vertexCount == 0 || indexBytes == 0) {
+        std::cerr << "Error: Invalid arena allocation of " << vertexCount << " vertices and " << indexBytes << " index bytes" << std::endl;
+        return false;
+    }
+    MeshArena& arena = pool.arenas[arenaIndex];
+    indexBytes = (indexBytes + kIndexAlignment - 1) / kIndexAlignment * kIndexAlignment;
+
+    if (LargestFreeRange(arena.vertices) < vertexCount || LargestFreeRange(arena.indices) < indexBytes) {
+        GrowMeshArena(arena, vertexCount, indexBytes);
+    }
+    if (!AllocateRange(arena.vertices, vertexCount, allocation.vertexOffset)) {
+        return false;
+    }
+    if (!AllocateRange(arena.indices, indexBytes, allocation.indexOffset)) {
+        FreeRange(arena.vertices, allocation.vertexOffset);
+        return false;
+    }
+    allocation.arena = arenaIndex;
+    allocation.vertexCount = vertexCount;
+    allocation.indexBytes = indexBytes;
+    return true;
+}
+
+void WriteMeshArenaVertices(const MeshArena& arena, const GpuAllocation& allocation, const std::vector<unsigned char>& packed) {
+    // The packed data has the same streams as the arena, each holding allocation.vertexCount vertices
+    CachedBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+    size_t source = 0, stream = 0;
+    for (size_t stride : StreamStrides(arena)) {
+        size_t bytes = allocation.vertexCount * stride;
+        if (source + bytes > packed.size()) {
+            std::cerr << "Error: Packed vertices are smaller than their arena allocation" << std::endl;
+            break;
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, stream + allocation.vertexOffset * stride, bytes, packed.data() + source);
+        source += bytes;
+        stream += arena.vertices.capacity * stride;
+    }
+    CachedBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void WriteMeshArenaIndices(const MeshArena& arena, const GpuAllocation& allocation, const void* indices, size_t bytes) {
+    // Written through the copy target so the element binding of whatever VAO is bound is left alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, arena.ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset, std::min(bytes, allocation.indexBytes), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void FreeMeshArenaRanges(GpuBufferPool& pool, GpuAllocation& allocation) {
+    if (allocation.arena < 0 || allocation.arena >= static_cast<int>(pool.arenas.size())) {
+        return;
+    }
+    MeshArena& arena = pool.arenas[allocation.arena];
+    FreeRange(arena.vertices, allocation.vertexOffset);
+    FreeRange(arena.indices, allocation.indexOffset);
+    allocation = GpuAllocation();
+}
+
+void SetupMeshArenaAttributes(const MeshArena& arena) {
+    size_t capacity = arena.vertices.capacity;
+    CachedBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+    SetupVertexAttributes(arena.format, capacity);
+    if (arena.hasTangents) {
+        SetupTangentAttribute(GetAttributeStreamOffset(arena.format, capacity) + capacity * GetVertexLayout(arena.format).stride);
+    }
+    CachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.ebo);
+}
+
+void DefragmentGpuBufferPool(GpuBufferPool& pool, const std::vector<Model*>& models) {
+    for (size_t a = 0; a < pool.arenas.size(); ++a) {
+        MeshArena& arena = pool.arenas[a];
+        if (LargestFreeRange(arena.vertices) == arena.vertices.capacity - arena.vertices.used
+            && LargestFreeRange(arena.indices) == arena.indices.capacity - arena.indices.used) {
+            continue; // Already one free range on each side
+        }
+
+        std::vector<RangeMove> vertexMoves = CompactRanges(arena.vertices);
+        std::vector<RangeMove> indexMoves = CompactRanges(arena.indices);
+        RebuildMeshArena(arena, arena.vertices.capacity, arena.indices.capacity, vertexMoves, indexMoves);
+
+        std::unordered_map<size_t, size_t> vertexTargets, indexTargets;
+        for (const RangeMove& move : vertexMoves) {
+            vertexTargets[move.from] = move.to;
+        }
+        for (const RangeMove& move : indexMoves) {
+            indexTargets[move.from] = move.to;
+        }
+        for (Model* model : models) {
+            if (model->pool != &pool || model->allocation.arena != static_cast<int>(a)) {
+                continue;
+            }
+            GpuAllocation moved = model->allocation;
+            moved.vertexOffset = vertexTargets[model->allocation.vertexOffset];
+            moved.indexOffset = indexTargets[model->allocation.indexOffset];
+            RelocateModel(*model, moved);
+        }
+    }
+}
+
+void ReleaseGpuBufferPool(GpuBufferPool& pool) {
+    for (MeshArena& arena : pool.arenas) {
+        Unload(arena.vao, arena.vbo, arena.ebo);
+    }
+    pool.arenas.clear();
+}
@@ -0,0 +1,205 @@
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <cmath>
+#include "impostor.h"
+#include "vertexFormat.h"
+#include "glState.h"
+
+namespace {
+
+// Uniforms of impostor.vs and impostor.fs, resolved to locations once per shader
+const UniformHandle kModelUniform("model");
+const UniformHandle kViewUniform("view");
+const UniformHandle kProjectionUniform("projection");
+const UniformHandle kObjectCameraPosUniform("objectCameraPos");
+const UniformHandle kCenterUniform("center");
+const UniformHandle kRadiusUniform("radius");
+const UniformHandle kFramesPerSideUniform("framesPerSide");
+const UniformHandle kLightPosUniform("lightPos");
+const UniformHandle kLightColorUniform("lightColor");
+const UniformHandle kAlbedoAtlasUniform("albedoAtlas");
+const UniformHandle kNormalAtlasUniform("normalAtlas");
+
+// View matrix looking at the center from direction, with the up vector impostor.vs rebuilds
+glm::mat4 FrameView(const glm::vec3& center, float radius, const glm::vec3& direction) {
+    glm::vec3 upHint = std::abs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    return glm::lookAt(center + direction * (radius * 2.0f), center, upHint);
+}
+
+unsigned int CreateAtlasTexture(int size) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    CachedBindTexture(0, GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+} // namespace
+
+bool BakeImpostor(Model& model, ShaderVariantCache& bakeShaders, const ImpostorOptions& options, Impostor& impostor) {
+    // Bounding sphere over every mesh of the model
+    bool hasVertices = false;
+    glm::vec3 minPos(0.0f), maxPos(0.0f);
+    for (const Mesh& mesh : model.meshes) {
+        for (const Vertex& v : mesh.vertices) {
+            glm::vec3 p(v.x, v.y, v.z);
+            minPos = hasVertices ? glm::min(minPos, p) : p;
+            maxPos = hasVertices ? glm::max(maxPos, p) : p;
+            hasVertices = true;
+        }
+    }
+    if (!hasVertices || options.framesPerSide == 0 || options.frameSize == 0) {
+        std::cerr << "Error: Nothing to bake into an impostor" << std::endl;
+        return false;
+    }
+    impostor.center = (minPos + maxPos) * 0.5f;
+    impostor.radius = std::max(glm::length(maxPos - minPos) * 0.5f, 1e-4f);
+    impostor.framesPerSide = options.framesPerSide;
+    impostor.switchDistance = options.switchDistance;
+
+    int frameSize = static_cast<int>(options.frameSize);
+    int atlasSize = static_cast<int>(options.framesPerSide) * frameSize;
+    impostor.albedoTexture = CreateAtlasTexture(atlasSize);
+    impostor.normalTexture = CreateAtlasTexture(atlasSize);
+
+    unsigned int framebuffer, depthBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+
+    GLint previousFramebuffer = 0, previousViewport[4];
+    GLfloat previousClearColor[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, impostor.albedoTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, impostor.normalTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (complete) {
+        // Uncovered texels keep zero alpha so the impostor shader can discard them
+        glViewport(0, 0, atlasSize, atlasSize);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // The atlas only keeps albedo and normals, so the diffuse map is the one feature that matters
+        std::vector<Shader*> materialShaders;
+        for (const Material& material : model.materials) {
+            unsigned int features = MaterialShaderFeatures(material, model.hasTangents) & SHADER_FEATURE_DIFFUSE_MAP;
+            materialShaders.push_back(&GetShaderVariant(bakeShaders, features));
+        }
+
+        float r = impostor.radius;
+        glm::mat4 projection = glm::ortho(-r, r, -r, r, r * 0.5f, r * 3.5f);
+        for (unsigned int y = 0; y < options.framesPerSide; ++y) {
+            for (unsigned int x = 0; x < options.framesPerSide; ++x) {
+                // Frame centers on the octahedral grid, decoded to the direction the view is taken from
+                glm::vec2 grid = (glm::vec2(x, y) + 0.5f) / static_cast<float>(options.framesPerSide);
+                glm::vec3 direction = OctDecode(grid * 2.0f - 1.0f);
+
+                glViewport(static_cast<int>(x) * frameSize, static_cast<int>(y) * frameSize, frameSize, frameSize);
+                DrawModelView(model, materialShaders, FrameView(impostor.center, r, direction), projection, glm::mat4(1.0f));
+            }
+        }
+    }
+    else {
+        std::cerr << "Error: Impostor framebuffer is incomplete" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<unsigned int>(previousFramebuffer));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+
+    if (!complete) {
+        UnloadImpostor(impostor);
+        return false;
+    }
+
+    CachedBindTexture(0, GL_TEXTURE_2D, impostor.albedoTexture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    CachedBindTexture(0, GL_TEXTURE_2D, impostor.normalTexture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    CachedBindTexture(0, GL_TEXTURE_2D, 0);
+
+    // Quad corners in [-1, 1], expanded along the chosen frame's axes in impostor.vs
+    const float corners[8] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenVertexArrays(1, &impostor.vao);
+    glGenBuffers(1, &impostor.vbo);
+    CachedBindVertexArray(impostor.vao);
+    CachedBindBuffer(GL_ARRAY_BUFFER, impostor.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    CachedBindVertexArray(0);
+    return true;
+}
+
+bool ShouldDrawImpostor(const Impostor& impostor, const Camera& camera, float time) {
+    if (impostor.vao == 0) {
+        return false;
+    }
+    glm::vec3 center = glm::vec3(MeshModelMatrix(time) * glm::vec4(impostor.center, 1.0f));
+    return glm::length(center - camera.Position) - impostor.radius > impostor.switchDistance;
+}
+
+void DrawImpostor(
+    Impostor& impostor, Shader& impostorShader, Camera& camera,
+    const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT,
+    glm::vec3 lightPos, glm::vec3 lightColor, float time)
+{
+    impostorShader.use();
+
+    glm::mat4 model = MeshModelMatrix(time);
+    glm::mat4 projection = glm::perspective(
+        glm::radians(camera.Zoom),
+        static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT),
+        0.1f,
+        100.0f
+    );
+    impostorShader.setMat4(kModelUniform, model);
+    impostorShader.setMat4(kViewUniform, camera.GetViewMatrix());
+    impostorShader.setMat4(kProjectionUniform, projection);
+
+    // The view is picked from the camera direction in object space
+    impostorShader.setVec3(kObjectCameraPosUniform, glm::vec3(glm::inverse(model) * glm::vec4(camera.Position, 1.0f)));
+    impostorShader.setVec3(kCenterUniform, impostor.center);
+    impostorShader.setFloat(kRadiusUniform, impostor.radius);
+    impostorShader.setFloat(kFramesPerSideUniform, static_cast<float>(impostor.framesPerSide));
+
+    impostorShader.setVec3(kLightPosUniform, lightPos);
+    impostorShader.setVec3(kLightColorUniform, lightColor);
+
+    CachedBindTexture(0, GL_TEXTURE_2D, impostor.albedoTexture);
+    impostorShader.setInt(kAlbedoAtlasUniform, 0);
+    CachedBindTexture(1, GL_TEXTURE_2D, impostor.normalTexture);
+    impostorShader.setInt(kNormalAtlasUniform, 1);
+
+    CachedBindVertexArray(impostor.vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void UnloadImpostor(Impostor& impostor) {
+    glDeleteTextures(1, &impostor.albedoTexture);
+    glDeleteTextures(1, &impostor.normalTexture);
+    glDeleteVertexArrays(1, &impostor.vao);
+    glDeleteBuffers(1, &impostor.vbo);
+    InvalidateGLState(); // The deleted names may still be shadowed as bound
+
+    impostor.albedoTexture = 0;
+    impostor.normalTexture = 0;
+    impostor.vao = 0;
+    impostor.vbo = 0;
+}
@@ -0,0 +1,144 @@
+#include <glad/glad.h>
+#include <iostream>
+#include <cstddef>
+#include "instancing.h"
+#include "parallel.h"
+#include "uniformBuffers.h"
+#include "glState.h"
+
+namespace {
+
+// Attribute locations of the INSTANCING variant of default.vs, after the four vertex attributes
+const GLuint kInstanceModelLocation = 4;   // mat4, four vec4 columns
+const GLuint kInstanceNormalLocation = 8;  // mat3, three vec3 columns
+const GLuint kInstanceTintLocation = 11;
+
+// One instance as stored in the instance buffer
+struct PackedInstance {
+    float model[16];
+    float normal[9];
+    float tint[4];
+};
+static_assert(sizeof(PackedInstance) == 116, "PackedInstance must be tightly packed");
+
+void SetupInstanceAttributes() {
+    const GLsizei stride = sizeof(PackedInstance);
+    for (GLuint column = 0; column < 4; ++column) {
+        GLuint location = kInstanceModelLocation + column;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(PackedInstance, model) + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    for (GLuint column = 0; column < 3; ++column) {
+        GLuint location = kInstanceNormalLocation + column;
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(PackedInstance, normal) + column * 3 * sizeof(float)));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribPointer(kInstanceTintLocation, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedInstance, tint));
+    glEnableVertexAttribArray(kInstanceTintLocation);
+    glVertexAttribDivisor(kInstanceTintLocation, 1);
+}
+
+} // namespace
+
+bool CreateInstanceBatch(const Model& model, InstanceBatch& batch) {
+    if (model.vao == 0 || model.submeshes.empty()) {
+        std::cerr << "Error: Instance batch needs a model uploaded to the GPU" << std::endl;
+        return false;
+    }
+
+    glGenVertexArrays(1, &batch.vao);
+    glGenBuffers(1, &batch.instanceBuffer);
+    CachedBindVertexArray(batch.vao);
+    SetupModelAttributes(model);
+
+    CachedBindBuffer(GL_ARRAY_BUFFER, batch.instanceBuffer);
+    SetupInstanceAttributes();
+    CachedBindVertexArray(0);
+
+    batch.instanceCount = 0;
+    batch.capacity = 0;
+    return true;
+}
+
+void UploadInstances(InstanceBatch& batch, const InstanceData* instances, size_t count) {
+    std::vector<PackedInstance> packed(count);
+    ParallelFor(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const InstanceData& instance = instances[i];
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(instance.model)));
+            PackedInstance& dst = packed[i];
+            for (int c = 0; c < 4; ++c) {
+                for (int r = 0; r < 4; ++r) {
+                    dst.model[c * 4 + r] = instance.model[c][r];
+                }
+            }
+            for (int c = 0; c < 3; ++c) {
+                for (int r = 0; r < 3; ++r) {
+                    dst.normal[c * 3 + r] = normalMatrix[c][r];
+                }
+            }
+            for (int k = 0; k < 4; ++k) {
+                dst.tint[k] = instance.tint[k];
+            }
+        }
+    });
+
+    CachedBindBuffer(GL_ARRAY_BUFFER, batch.instanceBuffer);
+    GLsizeiptr size = static_cast<GLsizeiptr>(count * sizeof(PackedInstance));
+    if (count > batch.capacity) {
+        glBufferData(GL_ARRAY_BUFFER, size, packed.data(), GL_DYNAMIC_DRAW);
+        batch.capacity = count;
+    }
+    else {
+        // Orphan the old storage so frames still reading it don't stall the upload
+        glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(batch.capacity * sizeof(PackedInstance)), nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, packed.data());
+    }
+    CachedBindBuffer(GL_ARRAY_BUFFER, 0);
+    batch.instanceCount = count;
+}
+
+void UploadInstances(InstanceBatch& batch, const std::vector<InstanceData>& instances) {
+    UploadInstances(batch, instances.data(), instances.size());
+}
+
+void DrawModelInstanced(const Model& model, const InstanceBatch& batch, ShaderVariantCache& shaders, const glm::mat4& parent) {
+    if (batch.vao == 0 || batch.instanceCount == 0) {
+        return;
+    }
+    SetObjectUniforms(parent, model.format, model.quantization);
+
+    size_t indexSize = model.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    GLsizei instanceCount = static_cast<GLsizei>(batch.instanceCount);
+
+    CachedBindVertexArray(batch.vao);
+    unsigned int boundMaterial = static_cast<unsigned int>(-1);
+    for (size_t i = 0; i < model.submeshes.size(); ++i) {
+        const Submesh& submesh = model.submeshes[i];
+        if (submesh.materialId != boundMaterial) {
+            const Material& material = model.materials[submesh.materialId];
+            Shader& shader = GetShaderVariant(shaders, MaterialShaderFeatures(material, model.hasTangents) | SHADER_FEATURE_INSTANCING);
+            shader.use();
+            BindMaterial(shader, material);
+            boundMaterial = submesh.materialId;
+        }
+
+        // Instances skip LOD selection and meshlet culling, so every copy draws the full detail range
+        glDrawElementsInstancedBaseVertex(
+            GL_TRIANGLES, static_cast<GLsizei>(submesh.indexCount), model.indexType,
+            (void*)(submesh.indexOffset * indexSize), instanceCount,
+            static_cast<GLint>(model.meshes[i].baseVertex));
+    }
+}
+
+void UnloadInstanceBatch(InstanceBatch& batch) {
+    glDeleteVertexArrays(1, &batch.vao);
+    glDeleteBuffers(1, &batch.instanceBuffer);
+    InvalidateGLState(); // The deleted names may still be shadowed as bound
+    batch.vao = 0;
+    batch.instanceBuffer = 0;
+    batch.instanceCount = 0;
+    batch.capacity = 0;
+}
@@ -2,6 +2,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <fstream>
+#include <cmath>
 #include <gl2d/gl2d.h>
 #include <openglErrorReporting.h>
 
@@ -11,6 +13,22 @@
 #include "imguiThemes.h"
 
 #include "riceLoader.h"
+#include "meshOptimizer.h"
+#include "meshCleaner.h"
+#include "meshSimplifier.h"
+#include "meshlets.h"
+#include "meshCache.h"
+#include "impostor.h"
+#include "progressiveMesh.h"
+#include "uniformBuffers.h"
+#include "renderQueue.h"
+#include "instancing.h"
+#include "gpuBuffers.h"
+#include "glState.h"
+#include "shaderVariants.h"
+#include "textureCache.h"
+#include "staticBatch.h"
+#include "tangentGenerator.h"
 #include "fileManager.h"
 #include "shader.h"
 #include "camera.h"
@@ -24,11 +42,29 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-unsigned int loadTexture(const char* path);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+const bool CLEAN_MESHES = true; // weld near-duplicate vertices and drop degenerate or repeated triangles after loading
+const bool OPTIMIZE_MESHES = true; // reorder meshes for the vertex cache, overdraw and vertex fetch after loading
+const VertexFormat VERTEX_FORMAT = VertexFormat::Compact16().Split(); // GPU vertex storage, Full() keeps 32 byte float vertices
+const bool BUILD_LODS = true; // simplify each mesh into a LOD chain picked by screen-space error
+const bool BUILD_MESHLETS = true; // split meshes into clusters culled on the CPU by frustum and normal cone
+const bool USE_MESH_CACHE = true; // load processed meshes from a .rlmesh next to the model, rebuilt when the model changes
+const bool BUILD_TANGENTS = false; // generate tangents for every model, not only ones with normal-mapped materials; stored in the cache and uploaded on attribute 3
+const bool SHADER_BINARY_CACHE = true; // save linked shader programs under resources/shaderCache and load them on later launches
+const bool SHARED_GPU_BUFFERS = true; // sub-allocate models from large per-format buffers behind one VAO instead of a VAO, VBO and EBO each
+const bool BAKE_IMPOSTOR = true; // bake an octahedral impostor atlas at load time and draw it beyond IMPOSTOR_DISTANCE
+const float IMPOSTOR_DISTANCE = 20.0f; // distance from the camera to the model's bounds where the impostor takes over
+const bool PROGRESSIVE_STREAMING = false; // stream the first mesh from a .rlprog in place of the model: coarse base first, refined as the file is read
+const size_t PROGRESSIVE_BYTES_PER_FRAME = 16 * 1024; // bytes read from the .rlprog each frame
+const size_t PROGRESSIVE_RECORDS_PER_FRAME = 64; // refinement records applied and uploaded each frame
+const size_t INSTANCE_COUNT = 0; // extra copies of the model drawn with one instanced call per submesh on a grid around it, 0 turns them off
+const float INSTANCE_SPACING = 3.0f; // distance between neighbouring copies on the grid
+const size_t STATIC_BATCH_COPIES = 0; // static copies of the model on a grid below it, merged into world space batches per material, culled per copy and drawn through the render queue, 0 turns them off
+const bool MULTI_DRAW_INDIRECT = false; // ask for a 4.3 context and submit each run of draws sharing state with one glMultiDrawElementsIndirect, falls back to 3.3
+const bool DEPTH_PREPASS = true; // lay down depth with positions only so the lighting shader runs once per pixel
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -51,7 +87,7 @@ int main(void)
     if (!glfwInit())
         exit(EXIT_FAILURE);
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, MULTI_DRAW_INDIRECT ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, 1);
@@ -59,6 +95,12 @@ int main(void)
 #endif
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Rice Loader", NULL, NULL);
+    if (!window && MULTI_DRAW_INDIRECT)
+    {
+        // No 4.3 driver: keep the 3.3 context and the per-draw path
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Rice Loader", NULL, NULL);
+    }
     if (!window)
     {
         glfwTerminate();
@@ -77,7 +119,8 @@ int main(void)
         exit(EXIT_FAILURE);
     }
 
-    glEnable(GL_DEPTH_TEST);
+    CachedEnable(GL_DEPTH_TEST);
+    CachedEnable(GL_CULL_FACE); // back faces are never drawn, which meshlet cone culling relies on
 
     // Initialize ImGui
 #pragma region imgui
@@ -102,25 +145,240 @@ int main(void)
 #endif
 #pragma endregion
 
-    // Load shaders, materials, and models
-    Shader shader((sfp + "default.vs").c_str(), (sfp + "default.fs").c_str());
+    // Load shaders, materials, and models. Shaders only submit their builds here; each is waited for at its
+    // first use, so the compiles run alongside the model loading below.
+    std::string shaderCachePath = sfp + "shaderCache/";
+    const char* shaderCache = SHADER_BINARY_CACHE ? shaderCachePath.c_str() : nullptr;
+    Shader depthShader((sfp + "depth.vs").c_str(), (sfp + "depth.fs").c_str(), shaderCache);
+    Shader impostorShader((sfp + "impostor.vs").c_str(), (sfp + "impostor.fs").c_str(), shaderCache);
+    BindUniformBlocks(depthShader);
+
     std::vector<Mesh> modelMeshes;
     std::unordered_map<std::string, Material> materials;
 
     LoadMaterial((sfp + "Monkey.mtl").c_str(), materials); // Load materials
-    LoadModel((sfp + "Monkey.obj").c_str(), modelMeshes);  // Load model meshes
 
-    // Load meshes into GPU
-    std::vector<unsigned int> vaos, vbos, ebos;
-    for (const auto& mesh : modelMeshes)
+    // Normal maps need tangents, so they are built whenever a material has one
+    MeshBuildSettings buildSettings;
+    buildSettings.clean = CLEAN_MESHES;
+    buildSettings.optimize = OPTIMIZE_MESHES;
+    buildSettings.tangents = BUILD_TANGENTS;
+    buildSettings.lods = BUILD_LODS;
+    buildSettings.meshlets = BUILD_MESHLETS;
+    for (const auto& material : materials)
+    {
+        buildSettings.tangents = buildSettings.tangents || !material.second.normalTexturePath.empty();
+    }
+
+    // Texture maps decode on worker threads while the model loads; until they are uploaded a placeholder is drawn
+    TextureCache textures;
+    InitTextureCache(textures);
+    for (auto& material : materials)
+    {
+        AcquireMaterialTextures(textures, material.second, sfp);
+    }
+
+    // default.vs and default.fs are compiled per feature mask; the ones the materials need are submitted now
+    ShaderVariantCache shaderVariants;
+    InitShaderVariants(shaderVariants, sfp + "default.vs", sfp + "default.fs", SHADER_BINARY_CACHE ? shaderCachePath : "");
+    std::vector<unsigned int> startupVariants = { 0 };
+    for (const auto& material : materials)
+    {
+        unsigned int features = MaterialShaderFeatures(material.second, buildSettings.tangents);
+        startupVariants.push_back(features);
+        if (INSTANCE_COUNT > 0)
+        {
+            startupVariants.push_back(features | SHADER_FEATURE_INSTANCING);
+        }
+    }
+    if (INSTANCE_COUNT > 0)
+    {
+        startupVariants.push_back(SHADER_FEATURE_INSTANCING);
+    }
+    PrepareShaderVariants(shaderVariants, startupVariants);
+
+    // The impostor bake shares default.vs, with a variant for materials that have a diffuse map
+    ShaderVariantCache impostorBakeShaders;
+    InitShaderVariants(impostorBakeShaders, sfp + "default.vs", sfp + "impostorBake.fs", SHADER_BINARY_CACHE ? shaderCachePath : "");
+    if (BAKE_IMPOSTOR)
     {
-        unsigned int vao, vbo, ebo;
-        LoadMeshToGPU(mesh, vao, vbo, ebo);
-        vaos.push_back(vao);
-        vbos.push_back(vbo);
-        ebos.push_back(ebo);
+        PrepareShaderVariants(impostorBakeShaders, { 0, SHADER_FEATURE_DIFFUSE_MAP });
     }
 
+    // Use the processed mesh cache when it is newer than the OBJ and built with these settings, otherwise rebuild it
+    std::string modelPath = sfp + "Monkey.obj";
+    std::string cachePath = sfp + "Monkey.rlmesh";
+    bool loadedFromCache = USE_MESH_CACHE && !IsMeshCacheStale(cachePath, modelPath, buildSettings) && LoadMeshCache(cachePath, modelMeshes);
+
+    std::vector<MeshOptimizeReport> optimizeReports;
+    if (!loadedFromCache)
+    {
+        LoadModel(modelPath.c_str(), modelMeshes);  // Load model meshes
+
+        // Clean up the raw geometry before any pass that reorders it
+        if (CLEAN_MESHES)
+        {
+            for (auto& mesh : modelMeshes)
+            {
+                MeshCleanReport report = CleanMesh(mesh, buildSettings.cleanOptions);
+                std::cout << "Cleaned mesh: welded " << report.weldedVertices << " vertices, removed "
+                    << report.degenerateTriangles << " degenerate and " << report.duplicateTriangles << " duplicate triangles" << std::endl;
+            }
+        }
+
+        // Optimize triangle and vertex order before upload
+        if (OPTIMIZE_MESHES)
+        {
+            for (auto& mesh : modelMeshes)
+            {
+                MeshOptimizeReport report = OptimizeMesh(mesh);
+                std::cout << "Optimized mesh: ACMR " << report.before.acmr << " -> " << report.after.acmr
+                    << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+                optimizeReports.push_back(report);
+            }
+        }
+
+        // Tangents follow the final vertex order and may split vertices, so generate them after optimization and before LODs
+        if (buildSettings.tangents)
+        {
+            for (auto& mesh : modelMeshes)
+            {
+                GenerateTangents(mesh);
+            }
+        }
+
+        // Build levels of detail after optimization so level 0 keeps the optimized order
+        if (BUILD_LODS)
+        {
+            for (auto& mesh : modelMeshes)
+            {
+                BuildLodChain(mesh, buildSettings.lodOptions);
+            }
+        }
+
+        // Cluster the full detail level for per-meshlet culling
+        if (BUILD_MESHLETS)
+        {
+            for (auto& mesh : modelMeshes)
+            {
+                BuildMeshlets(mesh);
+            }
+        }
+
+        if (USE_MESH_CACHE)
+        {
+            SaveMeshCache(cachePath, modelMeshes, buildSettings);
+        }
+    }
+
+    // Put every mesh into one set of GPU buffers, one submesh per material group
+    Model model;
+    BuildModel(std::move(modelMeshes), model);
+
+    // Use the materials loaded from Monkey.mtl where the names match
+    for (auto& material : model.materials)
+    {
+        auto found = materials.find(material.name);
+        if (found != materials.end())
+        {
+            material = found->second;
+        }
+    }
+
+    SetModelVertexFormat(model, VERTEX_FORMAT);
+    GpuBufferPool gpuBuffers;
+    if (!SHARED_GPU_BUFFERS || !LoadModelToGPU(model, gpuBuffers))
+    {
+        LoadModelToGPU(model);
+    }
+
+    // Render the model from every atlas direction before the first frame. Texture maps still loading are
+    // baked as their placeholders, so the atlas is baked again once the last one has arrived.
+    Impostor impostor;
+    ImpostorOptions impostorOptions;
+    impostorOptions.switchDistance = IMPOSTOR_DISTANCE;
+    bool impostorHasTextures = PendingTextures(textures) == 0;
+    if (BAKE_IMPOSTOR)
+    {
+        BakeImpostor(model, impostorBakeShaders, impostorOptions, impostor);
+    }
+
+    // Build the progressive file when it is stale, then open it to be read a slice per frame
+    ProgressiveMeshStream progressive;
+    std::ifstream progressiveFile;
+    std::vector<char> progressiveChunk(PROGRESSIVE_BYTES_PER_FRAME);
+    if (PROGRESSIVE_STREAMING && !model.meshes.empty())
+    {
+        std::string progressivePath = sfp + "Monkey.rlprog";
+        ProgressiveMeshOptions progressiveOptions;
+        progressiveOptions.format = VERTEX_FORMAT;
+        // A rebuilt mesh cache means the mesh it is made from may have changed too
+        if ((USE_MESH_CACHE && !loadedFromCache) || IsProgressiveMeshStale(progressivePath, modelPath, progressiveOptions))
+        {
+            ProgressiveMeshData progressiveData;
+            if (BuildProgressiveMesh(model.meshes[0], progressiveOptions, progressiveData))
+            {
+                SaveProgressiveMesh(progressivePath, progressiveData);
+            }
+        }
+        progressiveFile.open(progressivePath, std::ios::binary);
+        progressive.mesh.material = model.materials[model.submeshes[0].materialId];
+    }
+
+    // Lay the copies out on a square grid in the ground plane, each with its own tint
+    InstanceBatch instances;
+    if (INSTANCE_COUNT > 0 && CreateInstanceBatch(model, instances))
+    {
+        size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(INSTANCE_COUNT))));
+        std::vector<InstanceData> instanceData(INSTANCE_COUNT);
+        for (size_t i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            float x = (static_cast<float>(i % side) - 0.5f * static_cast<float>(side - 1)) * INSTANCE_SPACING;
+            float z = (static_cast<float>(i / side) + 1.0f) * INSTANCE_SPACING;
+            instanceData[i].model = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, -z));
+            instanceData[i].tint = glm::vec4(0.5f + 0.5f * glm::vec3(
+                std::sin(0.37f * i), std::sin(0.59f * i + 2.0f), std::sin(0.83f * i + 4.0f)), 1.0f);
+        }
+        UploadInstances(instances, instanceData);
+    }
+
+    // Pre-transform the static copies and merge them by material; the batch meshes move into their own model
+    std::vector<StaticBatch> staticBatches;
+    Model batchModel;
+    if (STATIC_BATCH_COPIES > 0)
+    {
+        size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(STATIC_BATCH_COPIES))));
+        std::vector<StaticInstance> staticInstances;
+        for (size_t i = 0; i < STATIC_BATCH_COPIES; ++i)
+        {
+            float x = (static_cast<float>(i % side) - 0.5f * static_cast<float>(side - 1)) * INSTANCE_SPACING;
+            float z = (static_cast<float>(i / side) + 1.0f) * INSTANCE_SPACING;
+            for (size_t m = 0; m < model.meshes.size(); ++m)
+            {
+                StaticInstance instance;
+                instance.mesh = &model.meshes[m];
+                instance.transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, -INSTANCE_SPACING, -z));
+                instance.materialId = model.submeshes[m].materialId;
+                staticInstances.push_back(instance);
+            }
+        }
+        staticBatches = BuildStaticBatches(staticInstances);
+
+        std::vector<Mesh> batchMeshes;
+        for (StaticBatch& batch : staticBatches)
+        {
+            batchMeshes.push_back(std::move(batch.mesh));
+        }
+        BuildModel(std::move(batchMeshes), batchModel);
+        SetModelVertexFormat(batchModel, VERTEX_FORMAT);
+        if (!SHARED_GPU_BUFFERS || !LoadModelToGPU(batchModel, gpuBuffers))
+        {
+            LoadModelToGPU(batchModel);
+        }
+    }
+
+    RenderQueue renderQueue;
+    renderQueue.indirect = MULTI_DRAW_INDIRECT && IsMultiDrawIndirectSupported();
     bool isCameraControlActive = true;
     // Main render loop
     while (!glfwWindowShouldClose(window))
@@ -156,17 +414,101 @@ int main(void)
         glm::vec3 lightPos = glm::vec3(1.2f, 1.0f, 2.0f);
         glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
 
-        // Draw each mesh
-        for (size_t i = 0; i < modelMeshes.size(); ++i)
+        // Hand finished decodes to the driver and retire completed uploads
+        UpdateTextureCache(textures);
+
+        // Baking overwrites the frame uniforms, so it happens before they are uploaded
+        if (impostor.vao != 0 && !impostorHasTextures && PendingTextures(textures) == 0)
+        {
+            UnloadImpostor(impostor);
+            BakeImpostor(model, impostorBakeShaders, impostorOptions, impostor);
+            impostorHasTextures = true;
+        }
+
+        // Camera and light are shared by every draw, so they are uploaded once here
+        BeginFrame(camera, SCR_WIDTH, SCR_HEIGHT, lightPos, lightColor);
+
+        // Feed the next slice of the progressive file and apply a bounded number of refinements
+        if (progressiveFile.is_open())
+        {
+            progressiveFile.read(progressiveChunk.data(), progressiveChunk.size());
+            FeedProgressiveMesh(progressive, progressiveChunk.data(), static_cast<size_t>(progressiveFile.gcount()));
+            if (!progressiveFile)
+            {
+                progressiveFile.close();
+            }
+        }
+        if (PROGRESSIVE_STREAMING)
+        {
+            RefineProgressiveMesh(progressive, PROGRESSIVE_RECORDS_PER_FRAME);
+        }
+        bool drawProgressive = progressive.mesh.vao != 0;
+
+        // Depth prepass: only the position stream is read, color writes are off
+        // Far away the model is replaced by a single quad, which needs no prepass
+        bool drawImpostor = ShouldDrawImpostor(impostor, camera, currentFrame);
+        bool depthPrepass = DEPTH_PREPASS && !drawImpostor;
+
+        // Queue the frame's geometry; sorting groups draws by state and orders them front to back
+        glm::mat4 modelMatrix = MeshModelMatrix(currentFrame);
+        BeginRenderQueue(renderQueue, camera, SCR_WIDTH, SCR_HEIGHT);
+        if (!drawImpostor && drawProgressive)
+        {
+            // The level refined so far, drawn as one prefix of its index buffer
+            if (depthPrepass)
+            {
+                SubmitMesh(renderQueue, RenderPass::Depth, progressive.mesh, progressive.mesh.vao, depthShader, nullptr, modelMatrix);
+            }
+            SubmitMesh(renderQueue, RenderPass::Opaque, progressive.mesh, progressive.mesh.vao,
+                GetShaderVariant(shaderVariants, MaterialShaderFeatures(progressive.mesh.material, false)), &progressive.mesh.material, modelMatrix);
+        }
+        else if (!drawImpostor)
+        {
+            // Every submesh with its own material through the model's single VAO
+            if (depthPrepass)
+            {
+                SubmitModel(renderQueue, RenderPass::Depth, model, depthShader, modelMatrix);
+            }
+            SubmitModel(renderQueue, RenderPass::Opaque, model, shaderVariants, modelMatrix);
+        }
+        if (!staticBatches.empty())
+        {
+            if (depthPrepass)
+            {
+                SubmitStaticBatches(renderQueue, RenderPass::Depth, staticBatches, batchModel, depthShader);
+            }
+            SubmitStaticBatches(renderQueue, RenderPass::Opaque, staticBatches, batchModel, shaderVariants);
+        }
+        SortRenderQueue(renderQueue);
+
+        if (depthPrepass)
         {
-            // Reference to the current mesh
-            Mesh& mesh = modelMeshes[i];  // Non-const reference
+            CachedColorMask(false);
+            ExecuteRenderQueue(renderQueue, RenderPass::Depth);
+            CachedColorMask(true);
 
-            // Find a material for the current mesh (default to first material if mapping is unclear)
-            Material material = materials.empty() ? Material() : materials.begin()->second;
+            // The lighting pass only shades the visible surface laid down above
+            CachedDepthMask(false);
+            CachedDepthFunc(GL_LEQUAL);
+        }
+
+        if (drawImpostor)
+        {
+            DrawImpostor(impostor, impostorShader, camera, SCR_WIDTH, SCR_HEIGHT, lightPos, lightColor, currentFrame);
+        }
+        ExecuteRenderQueue(renderQueue, RenderPass::Opaque);
 
-            // Draw the mesh (now passing non-const reference)
-            Draw(vaos[i], shader, mesh, material, camera, SCR_WIDTH, SCR_HEIGHT, lightPos, lightColor);
+        // Every copy in one call per submesh, after the depth state is back to normal
+        bool drawInstances = instances.instanceCount > 0;
+
+        if (depthPrepass)
+        {
+            CachedDepthMask(true);
+            CachedDepthFunc(GL_LESS);
+        }
+        if (drawInstances)
+        {
+            DrawModelInstanced(model, instances, shaderVariants, modelMatrix);
         }
 
         // ImGui rendering
@@ -179,10 +521,54 @@ int main(void)
         ImGui::Begin("Model Info");
         ImGui::Text("Model: spider.obj");
         ImGui::Text("Material: spider.mtl");
-        ImGui::Text("Meshes: %zu", modelMeshes.size());
-        if (!modelMeshes.empty())
+        ImGui::Text("Submeshes: %zu, materials: %zu%s", model.submeshes.size(), model.materials.size(), loadedFromCache ? " (from cache)" : "");
+        if (!model.meshes.empty())
         {
-            ImGui::Text("Vertices in first mesh: %zu", modelMeshes[0].vertices.size());
+            ImGui::Text("Vertices in first mesh: %zu", model.meshes[0].vertices.size());
+            ImGui::Text("Index size: %d bit", model.meshes[0].indexType == GL_UNSIGNED_SHORT ? 16 : 32);
+            ImGui::Text("Meshlets in first mesh: %zu", model.meshes[0].meshlets.size());
+            for (size_t l = 0; l < model.meshes[0].lods.size(); ++l)
+            {
+                ImGui::Text("LOD %zu: %u triangles, error %.4f", l,
+                    model.meshes[0].lods[l].indexCount / 3, model.meshes[0].lods[l].error);
+            }
+        }
+        ImGui::Text("Bytes per vertex: %zu", GetVertexLayout(VERTEX_FORMAT).bytesPerVertex);
+        ImGui::Text("Depth prepass: %s", DEPTH_PREPASS ? "on" : "off");
+        ImGui::Text("Render queue: %zu draws, %zu shader, %zu material, %zu VAO changes", renderQueue.commands.size(),
+            renderQueue.shaderChanges, renderQueue.materialChanges, renderQueue.vaoChanges);
+        ImGui::Text("Draw calls: %zu depth, %zu opaque, %zu transparent%s",
+            renderQueue.drawCalls[static_cast<size_t>(RenderPass::Depth)],
+            renderQueue.drawCalls[static_cast<size_t>(RenderPass::Opaque)],
+            renderQueue.drawCalls[static_cast<size_t>(RenderPass::Transparent)],
+            renderQueue.indirect ? " (multi-draw indirect)" : "");
+        ImGui::Text("Shader variants: %zu / %zu built", ReadyShaderVariants(shaderVariants), shaderVariants.variants.size());
+        ImGui::Text("Textures: %zu, %zu still loading", textures.byTexture.size(), PendingTextures(textures));
+        ImGui::Text("GL state calls: %zu issued, %zu redundant skipped", GetGLStateStats().issued, GetGLStateStats().skipped);
+        if (PROGRESSIVE_STREAMING)
+        {
+            ImGui::Text("Progressive: %zu / %zu refinements, %u triangles, error %.4f",
+                progressive.recordsApplied, progressive.recordCount, progressive.mesh.indexCount / 3, progressive.error);
+        }
+        for (const MeshArena& arena : gpuBuffers.arenas)
+        {
+            ImGui::Text("GPU arena: %zu / %zu vertices, %zu / %zu index bytes", arena.vertices.used, arena.vertices.capacity,
+                arena.indices.used, arena.indices.capacity);
+        }
+        if (drawInstances)
+        {
+            ImGui::Text("Instances: %zu in %zu draw calls", instances.instanceCount, model.submeshes.size());
+        }
+        if (!staticBatches.empty())
+        {
+            ImGui::Text("Static copies: %zu merged into %zu batches", STATIC_BATCH_COPIES, staticBatches.size());
+        }
+        ImGui::Text("Impostor: %s", drawImpostor ? "drawn" : (impostor.vao != 0 ? "baked" : "off"));
+        for (size_t i = 0; i < optimizeReports.size(); ++i)
+        {
+            ImGui::Text("Mesh %zu ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f", i,
+                optimizeReports[i].before.acmr, optimizeReports[i].after.acmr,
+                optimizeReports[i].before.atvr, optimizeReports[i].after.atvr);
         }
         ImGui::End();
 
@@ -204,10 +590,17 @@ int main(void)
     }
 
     // Cleanup GPU resources
-    for (size_t i = 0; i < vaos.size(); ++i)
-    {
-        Unload(vaos[i], vbos[i], ebos[i]);
-    }
+    UnloadModel(model);
+    UnloadModel(batchModel);
+    UnloadImpostor(impostor);
+    UnloadInstanceBatch(instances);
+    UnloadProgressiveMesh(progressive);
+    ReleaseRenderQueue(renderQueue);
+    ReleaseShaderVariants(shaderVariants);
+    ReleaseShaderVariants(impostorBakeShaders);
+    ReleaseTextureCache(textures);
+    ReleaseGpuBufferPool(gpuBuffers);
+    ReleaseUniformBuffers();
 
     // Terminate ImGui and GLFW
 #if REMOVE_IMGUI == 0
@@ -275,42 +668,3 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
 	camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
-
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(char const* path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
-}
@@ -0,0 +1,265 @@
+#include "meshAnalyzer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+
+namespace {
+
+glm::vec3 PositionOf(const Vertex& v) {
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+// Exact bit pattern of a vertex, so only true duplicates compare equal
+struct VertexBits {
+    uint32_t bits[8];
+
+    bool operator==(const VertexBits& other) const {
+        return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+    }
+};
+
+struct VertexBitsHash {
+    size_t operator()(const VertexBits& key) const {
+        size_t h = 0;
+        for (uint32_t b : key.bits) {
+            h ^= std::hash<uint32_t>()(b) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        }
+        return h;
+    }
+};
+
+float UniqueVertexRatio(const std::vector<Vertex>& vertices) {
+    if (vertices.empty()) {
+        return 0.0f;
+    }
+    static_assert(sizeof(Vertex) == sizeof(VertexBits), "Vertex is expected to be eight floats");
+    std::unordered_set<VertexBits, VertexBitsHash> unique;
+    unique.reserve(vertices.size());
+    for (const Vertex& v : vertices) {
+        VertexBits key;
+        std::memcpy(key.bits, &v, sizeof(key.bits));
+        unique.insert(key);
+    }
+    return static_cast<float>(unique.size()) / static_cast<float>(vertices.size());
+}
+
+// Evenly spread directions on the unit sphere (Fibonacci lattice)
+glm::vec3 ViewDirection(unsigned int view, unsigned int viewCount) {
+    const float goldenAngle = 2.39996323f;
+    float y = 1.0f - 2.0f * (static_cast<float>(view) + 0.5f) / static_cast<float>(viewCount);
+    float r = std::sqrt(std::max(0.0f, 1.0f - y * y));
+    float phi = goldenAngle * static_cast<float>(view);
+    return glm::vec3(r * std::cos(phi), y, r * std::sin(phi));
+}
+
+// Edge function: twice the signed area of (a, b, p)
+float Edge(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p) {
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// Top and left edges own the pixels exactly on them, so shared edges are not shaded twice
+bool IsTopLeft(const glm::vec2& a, const glm::vec2& b) {
+    return (a.y == b.y && b.x < a.x) || b.y < a.y;
+}
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCacheLru(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0 || cacheSize == 0) {
+        return stats;
+    }
+
+    // Most recently used first
+    std::vector<unsigned int> cache;
+    cache.reserve(cacheSize + 1);
+    std::vector<char> referenced(vertexCount, 0);
+    size_t misses = 0, uniqueVertices = 0;
+
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        unsigned int vertex = indices[i];
+        auto found = std::find(cache.begin(), cache.end(), vertex);
+        if (found != cache.end()) {
+            cache.erase(found);
+        }
+        else {
+            misses++;
+            if (cache.size() == cacheSize) {
+                cache.pop_back();
+            }
+        }
+        cache.insert(cache.begin(), vertex);
+
+        if (!referenced[vertex]) {
+            referenced[vertex] = 1;
+            uniqueVertices++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(triangleCount);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+float AnalyzeOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, unsigned int viewCount, unsigned int rasterSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertices.empty() || viewCount == 0 || rasterSize == 0) {
+        return 0.0f;
+    }
+
+    // Fit the bounding sphere into the raster for every view
+    glm::vec3 minPos = PositionOf(vertices[0]), maxPos = minPos;
+    for (const Vertex& v : vertices) {
+        minPos = glm::min(minPos, PositionOf(v));
+        maxPos = glm::max(maxPos, PositionOf(v));
+    }
+    glm::vec3 center = (minPos + maxPos) * 0.5f;
+    float radius = std::max(glm::length(maxPos - minPos) * 0.5f, 1e-6f);
+    float scale = static_cast<float>(rasterSize) / (2.0f * radius);
+
+    std::vector<float> depth(static_cast<size_t>(rasterSize) * rasterSize);
+    std::vector<glm::vec3> projected(vertices.size());
+    size_t shaded = 0, covered = 0;
+
+    for (unsigned int view = 0; view < viewCount; ++view) {
+        // Orthographic camera looking along forward, with the usual right-handed view basis
+        glm::vec3 forward = ViewDirection(view, viewCount);
+        glm::vec3 upHint = std::abs(forward.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 right = glm::normalize(glm::cross(forward, upHint));
+        glm::vec3 up = glm::cross(right, forward);
+
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            glm::vec3 p = PositionOf(vertices[v]) - center;
+            projected[v] = glm::vec3(
+                (glm::dot(p, right) + radius) * scale,
+                (glm::dot(p, up) + radius) * scale,
+                glm::dot(p, forward));
+        }
+
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+        for (size_t t = 0; t < triangleCount; ++t) {
+            glm::vec3 p0 = projected[indices[t * 3]];
+            glm::vec3 p1 = projected[indices[t * 3 + 1]];
+            glm::vec3 p2 = projected[indices[t * 3 + 2]];
+            glm::vec2 a(p0), b(p1), c(p2);
+
+            // Counter-clockwise triangles face the camera; the rest are culled as on the GPU
+            float area = Edge(a, b, c);
+            if (area <= 0.0f) {
+                continue;
+            }
+
+            int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+            int minY = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+            int maxX = std::min(static_cast<int>(rasterSize) - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+            int maxY = std::min(static_cast<int>(rasterSize) - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+            bool topLeft0 = IsTopLeft(b, c), topLeft1 = IsTopLeft(c, a), topLeft2 = IsTopLeft(a, b);
+
+            for (int y = minY; y <= maxY; ++y) {
+                for (int x = minX; x <= maxX; ++x) {
+                    glm::vec2 p(x + 0.5f, y + 0.5f);
+                    float w0 = Edge(b, c, p), w1 = Edge(c, a, p), w2 = Edge(a, b, p);
+                    bool inside = (w0 > 0.0f || (w0 == 0.0f && topLeft0)) &&
+                        (w1 > 0.0f || (w1 == 0.0f && topLeft1)) &&
+                        (w2 > 0.0f || (w2 == 0.0f && topLeft2));
+                    if (!inside) {
+                        continue;
+                    }
+
+                    float z = (w0 * p0.z + w1 * p1.z + w2 * p2.z) / area;
+                    float& stored = depth[static_cast<size_t>(y) * rasterSize + x];
+                    if (z < stored) {
+                        if (stored == std::numeric_limits<float>::max()) {
+                            covered++;
+                        }
+                        stored = z;
+                        shaded++;
+                    }
+                }
+            }
+        }
+    }
+
+    return covered > 0 ? static_cast<float>(shaded) / static_cast<float>(covered) : 0.0f;
+}
+
+float AnalyzeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount, const VertexFormat& format,
+    unsigned int cacheLine, unsigned int cacheLines)
+{
+    if (indices.empty() || vertexCount == 0 || cacheLine == 0) {
+        return 0.0f;
+    }
+
+    // One stream when interleaved, a position stream and an attribute stream when split
+    struct Stream {
+        size_t base, stride, size;
+    };
+    VertexLayout layout = GetVertexLayout(format);
+    std::vector<Stream> streams;
+    if (format.splitPositions) {
+        streams.push_back({ 0, layout.positionStride, layout.positionStride });
+        streams.push_back({ GetAttributeStreamOffset(format, vertexCount), layout.stride, layout.stride });
+    }
+    else {
+        streams.push_back({ 0, layout.stride, layout.stride });
+    }
+
+    size_t bufferSize = GetAttributeStreamOffset(format, vertexCount) + vertexCount * layout.stride;
+    size_t lineCount = (bufferSize + cacheLine - 1) / cacheLine;
+
+    // Same timestamp scheme as the post-transform FIFO: a line is resident for cacheLines loads
+    std::vector<size_t> timestamps(lineCount, 0);
+    size_t time = static_cast<size_t>(cacheLines) + 1;
+    size_t loadedBytes = 0;
+
+    std::vector<char> referenced(vertexCount, 0);
+    size_t uniqueVertices = 0;
+
+    for (unsigned int vertex : indices) {
+        if (!referenced[vertex]) {
+            referenced[vertex] = 1;
+            uniqueVertices++;
+        }
+
+        for (const Stream& stream : streams) {
+            size_t start = stream.base + vertex * stream.stride;
+            size_t end = start + stream.size;
+            for (size_t line = start / cacheLine; line <= (end - 1) / cacheLine; ++line) {
+                if (time - timestamps[line] > cacheLines) {
+                    timestamps[line] = time++;
+                    loadedBytes += cacheLine;
+                }
+            }
+        }
+    }
+
+    return static_cast<float>(loadedBytes) / static_cast<float>(uniqueVertices * layout.bytesPerVertex);
+}
+
+MeshAnalysis AnalyzeMesh(const Mesh& mesh, const MeshAnalyzeOptions& options) {
+    MeshAnalysis analysis;
+    analysis.vertexCount = mesh.vertices.size();
+    analysis.indexCount = mesh.indices.size();
+    analysis.triangleCount = mesh.indices.size() / 3;
+    if (analysis.triangleCount == 0) {
+        return analysis;
+    }
+
+    analysis.uniqueVertexRatio = UniqueVertexRatio(mesh.vertices);
+    analysis.fifo = AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), options.cacheSize);
+    analysis.lru = AnalyzeVertexCacheLru(mesh.indices, mesh.vertices.size(), options.cacheSize);
+    analysis.overdraw = AnalyzeOverdraw(mesh.indices, mesh.vertices, options.overdrawViews, options.rasterSize);
+    analysis.fetchOverfetch = AnalyzeVertexFetch(mesh.indices, mesh.vertices.size(), options.format,
+        options.fetchCacheLine, options.fetchCacheLines);
+
+    // Indices are 16 bit below 65536 vertices, matching LoadMeshToGPU
+    size_t indexSize = mesh.vertices.size() < 65536 ? sizeof(uint16_t) : sizeof(unsigned int);
+    size_t bytes = mesh.vertices.size() * GetVertexLayout(options.format).bytesPerVertex + mesh.indices.size() * indexSize;
+    analysis.bytesPerTriangle = static_cast<float>(bytes) / static_cast<float>(analysis.triangleCount);
+    return analysis;
+}
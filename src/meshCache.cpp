@@ -0,0 +1,365 @@
+#include "meshCache.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+const char kMagic[4] = { 'R', 'L', 'M', 'C' };
+const uint32_t kVersion = 4;
+
+constexpr uint32_t ChunkTag(char a, char b, char c, char d) {
+    return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+const uint32_t kVertexChunk = ChunkTag('V', 'E', 'R', 'T');
+const uint32_t kIndexChunk = ChunkTag('I', 'N', 'D', 'X');
+const uint32_t kMaterialChunk = ChunkTag('M', 'A', 'T', 'L');
+const uint32_t kBoundsChunk = ChunkTag('B', 'N', 'D', 'S');
+const uint32_t kLodChunk = ChunkTag('L', 'O', 'D', 'S');
+const uint32_t kMeshletChunk = ChunkTag('M', 'S', 'H', 'L');
+const uint32_t kTangentChunk = ChunkTag('T', 'A', 'N', 'G');
+const uint32_t kSettingsChunk = ChunkTag('S', 'E', 'T', 'T');
+
+// Appends plain values and arrays to a chunk payload
+struct ChunkWriter {
+    std::vector<char> data;
+
+    template <typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "cache values must be trivially copyable");
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void WriteArray(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable<T>::value, "cache values must be trivially copyable");
+        Write(static_cast<uint64_t>(values.size()));
+        const char* bytes = reinterpret_cast<const char*>(values.data());
+        data.insert(data.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    void WriteString(const std::string& value) {
+        Write(static_cast<uint64_t>(value.size()));
+        data.insert(data.end(), value.begin(), value.end());
+    }
+};
+
+// Reads values back from a chunk payload; any overrun marks the reader as failed
+struct ChunkReader {
+    const char* data;
+    size_t size;
+    size_t cursor = 0;
+    bool ok = true;
+
+    ChunkReader(const char* bytes, size_t length) : data(bytes), size(length) {}
+
+    template <typename T>
+    void Read(T& value) {
+        if (!ok || size - cursor < sizeof(T)) {
+            ok = false;
+            return;
+        }
+        std::memcpy(&value, data + cursor, sizeof(T));
+        cursor += sizeof(T);
+    }
+
+    template <typename T>
+    void ReadArray(std::vector<T>& values) {
+        uint64_t count = 0;
+        Read(count);
+        if (!ok || count > (size - cursor) / sizeof(T)) {
+            ok = false;
+            return;
+        }
+        values.resize(static_cast<size_t>(count));
+        std::memcpy(values.data(), data + cursor, values.size() * sizeof(T));
+        cursor += values.size() * sizeof(T);
+    }
+
+    void ReadString(std::string& value) {
+        uint64_t length = 0;
+        Read(length);
+        if (!ok || length > size - cursor) {
+            ok = false;
+            return;
+        }
+        value.assign(data + cursor, static_cast<size_t>(length));
+        cursor += static_cast<size_t>(length);
+    }
+};
+
+void WriteChunk(std::ofstream& file, uint32_t tag, const ChunkWriter& chunk) {
+    uint64_t size = chunk.data.size();
+    file.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(chunk.data.data(), chunk.data.size());
+}
+
+// Every index and range must land inside the arrays it points into, or a stale or damaged cache would
+// read out of bounds at upload and draw time
+bool ValidateMesh(const Mesh& mesh) {
+    size_t vertexCount = mesh.vertices.size();
+    auto indicesValid = [vertexCount](const std::vector<unsigned int>& indices) {
+        for (unsigned int index : indices) {
+            if (index >= vertexCount) {
+                return false;
+            }
+        }
+        return indices.size() % 3 == 0;
+    };
+    if (!indicesValid(mesh.indices) || !indicesValid(mesh.lodIndices)) {
+        return false;
+    }
+
+    // LOD ranges address the full detail indices followed by lodIndices
+    size_t lodSpace = mesh.indices.size() + mesh.lodIndices.size();
+    for (const MeshLod& lod : mesh.lods) {
+        if (lod.indexOffset > lodSpace || lod.indexCount > lodSpace - lod.indexOffset) {
+            return false;
+        }
+    }
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        if (meshlet.indexOffset > mesh.indices.size() || meshlet.indexCount > mesh.indices.size() - meshlet.indexOffset) {
+            return false;
+        }
+    }
+    return mesh.tangents.empty() || mesh.tangents.size() == vertexCount;
+}
+
+// Settings are compared by their serialized bytes; only fields that change the built data are written
+ChunkWriter SerializeSettings(const MeshBuildSettings& settings) {
+    ChunkWriter chunk;
+    chunk.Write(static_cast<uint8_t>(settings.clean));
+    chunk.Write(static_cast<uint8_t>(settings.optimize));
+    chunk.Write(static_cast<uint8_t>(settings.tangents));
+    chunk.Write(static_cast<uint8_t>(settings.lods));
+    chunk.Write(static_cast<uint8_t>(settings.meshlets));
+    if (settings.clean) {
+        chunk.Write(settings.cleanOptions.weldDistance);
+        chunk.Write(settings.cleanOptions.attributeEpsilon);
+        chunk.Write(static_cast<uint8_t>(settings.cleanOptions.removeDegenerates));
+        chunk.Write(static_cast<uint8_t>(settings.cleanOptions.removeDuplicates));
+    }
+    if (settings.lods) {
+        chunk.WriteArray(settings.lodOptions.errorTargets);
+        chunk.Write(settings.lodOptions.reduction);
+        chunk.Write(settings.lodOptions.minReduction);
+    }
+    return chunk;
+}
+
+// Read the header up to the settings chunk; the file is left at the mesh count
+bool ReadHeader(std::ifstream& file, uint32_t& version, std::vector<char>& settings) {
+    char magic[4];
+    uint32_t tag = 0;
+    uint64_t size = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    if (!file || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion) {
+        return false;
+    }
+    file.read(reinterpret_cast<char*>(&tag), sizeof(tag));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file || tag != kSettingsChunk || size > 4096) {
+        return false;
+    }
+    settings.resize(static_cast<size_t>(size));
+    file.read(settings.data(), settings.size());
+    return static_cast<bool>(file);
+}
+
+} // namespace
+
+bool SaveMeshCache(const std::string& cachePath, const std::vector<Mesh>& meshes, const MeshBuildSettings& settings) {
+    std::ofstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not write mesh cache " << cachePath << std::endl;
+        return false;
+    }
+
+    uint32_t meshCount = static_cast<uint32_t>(meshes.size());
+    file.write(kMagic, sizeof(kMagic));
+    file.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+    WriteChunk(file, kSettingsChunk, SerializeSettings(settings));
+    file.write(reinterpret_cast<const char*>(&meshCount), sizeof(meshCount));
+
+    for (const Mesh& mesh : meshes) {
+        // Tangents are optional and only stored when they were generated
+        uint32_t chunkCount = mesh.tangents.empty() ? 6 : 7;
+        file.write(reinterpret_cast<const char*>(&chunkCount), sizeof(chunkCount));
+
+        ChunkWriter vertices;
+        vertices.WriteArray(mesh.vertices);
+        WriteChunk(file, kVertexChunk, vertices);
+
+        ChunkWriter indices;
+        indices.WriteArray(mesh.indices);
+        WriteChunk(file, kIndexChunk, indices);
+
+        ChunkWriter material;
+        material.Write(mesh.material.ambient);
+        material.Write(mesh.material.diffuse);
+        material.Write(mesh.material.specular);
+        material.Write(mesh.material.shininess);
+        material.WriteString(mesh.material.texturePath);
+        material.WriteString(mesh.material.name);
+        material.WriteString(mesh.material.specularTexturePath);
+        material.WriteString(mesh.material.normalTexturePath);
+        WriteChunk(file, kMaterialChunk, material);
+
+        ChunkWriter bounds;
+        bounds.Write(mesh.boundsCenter);
+        bounds.Write(mesh.boundsRadius);
+        WriteChunk(file, kBoundsChunk, bounds);
+
+        ChunkWriter lods;
+        lods.WriteArray(mesh.lods);
+        lods.WriteArray(mesh.lodIndices);
+        WriteChunk(file, kLodChunk, lods);
+
+        ChunkWriter meshlets;
+        meshlets.WriteArray(mesh.meshlets);
+        WriteChunk(file, kMeshletChunk, meshlets);
+
+        if (!mesh.tangents.empty()) {
+            ChunkWriter tangents;
+            tangents.WriteArray(mesh.tangents);
+            WriteChunk(file, kTangentChunk, tangents);
+        }
+    }
+
+    if (!file.good()) {
+        std::cerr << "Error: Failed while writing mesh cache " << cachePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool LoadMeshCache(const std::string& cachePath, std::vector<Mesh>& meshes) {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Sizes read from the file are checked against what is left of it before anything is allocated
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+    auto remaining = [&file, fileSize]() {
+        std::streamoff position = file.tellg();
+        return position < 0 ? 0 : fileSize - static_cast<uint64_t>(position);
+    };
+
+    uint32_t version = 0, meshCount = 0;
+    std::vector<char> settings;
+    bool compatible = ReadHeader(file, version, settings);
+    file.read(reinterpret_cast<char*>(&meshCount), sizeof(meshCount));
+    if (!compatible || !file) {
+        std::cerr << "Error: " << cachePath << " is not a compatible mesh cache" << std::endl;
+        return false;
+    }
+    if (meshCount > remaining() / sizeof(uint32_t)) {
+        std::cerr << "Error: Truncated mesh cache " << cachePath << std::endl;
+        return false;
+    }
+
+    std::vector<Mesh> loaded(meshCount);
+    std::vector<char> payload;
+    for (Mesh& mesh : loaded) {
+        uint32_t chunkCount = 0;
+        file.read(reinterpret_cast<char*>(&chunkCount), sizeof(chunkCount));
+
+        for (uint32_t c = 0; c < chunkCount && file; ++c) {
+            uint32_t tag = 0;
+            uint64_t size = 0;
+            file.read(reinterpret_cast<char*>(&tag), sizeof(tag));
+            file.read(reinterpret_cast<char*>(&size), sizeof(size));
+            if (!file) {
+                break;
+            }
+            if (size > remaining()) {
+                std::cerr << "Error: Truncated mesh cache " << cachePath << std::endl;
+                return false;
+            }
+            payload.resize(static_cast<size_t>(size));
+            file.read(payload.data(), payload.size());
+
+            ChunkReader reader(payload.data(), payload.size());
+            if (tag == kVertexChunk) {
+                reader.ReadArray(mesh.vertices);
+            }
+            else if (tag == kIndexChunk) {
+                reader.ReadArray(mesh.indices);
+            }
+            else if (tag == kMaterialChunk) {
+                reader.Read(mesh.material.ambient);
+                reader.Read(mesh.material.diffuse);
+                reader.Read(mesh.material.specular);
+                reader.Read(mesh.material.shininess);
+                reader.ReadString(mesh.material.texturePath);
+                reader.ReadString(mesh.material.name);
+                reader.ReadString(mesh.material.specularTexturePath);
+                reader.ReadString(mesh.material.normalTexturePath);
+            }
+            else if (tag == kBoundsChunk) {
+                reader.Read(mesh.boundsCenter);
+                reader.Read(mesh.boundsRadius);
+            }
+            else if (tag == kLodChunk) {
+                reader.ReadArray(mesh.lods);
+                reader.ReadArray(mesh.lodIndices);
+            }
+            else if (tag == kMeshletChunk) {
+                reader.ReadArray(mesh.meshlets);
+            }
+            else if (tag == kTangentChunk) {
+                reader.ReadArray(mesh.tangents);
+            }
+
+            // Known chunks must be used up exactly, so a size that disagrees with the counts inside is caught
+            bool known = tag == kVertexChunk || tag == kIndexChunk || tag == kMaterialChunk || tag == kBoundsChunk
+                || tag == kLodChunk || tag == kMeshletChunk || tag == kTangentChunk;
+            if (!reader.ok || (known && reader.cursor != reader.size)) {
+                std::cerr << "Error: Corrupt chunk in mesh cache " << cachePath << std::endl;
+                return false;
+            }
+        }
+
+        if (!file) {
+            std::cerr << "Error: Truncated mesh cache " << cachePath << std::endl;
+            return false;
+        }
+        if (!ValidateMesh(mesh)) {
+            std::cerr << "Error: Mesh cache " << cachePath << " has indices or ranges out of bounds" << std::endl;
+            return false;
+        }
+    }
+
+    meshes.insert(meshes.end(), loaded.begin(), loaded.end());
+    return true;
+}
+
+bool IsMeshCacheStale(const std::string& cachePath, const std::string& sourcePath, const MeshBuildSettings& settings) {
+    std::error_code error;
+    if (!std::filesystem::exists(cachePath, error)) {
+        return true;
+    }
+    auto cacheTime = std::filesystem::last_write_time(cachePath, error);
+    if (error) {
+        return true;
+    }
+    auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+    if (!error && sourceTime > cacheTime) {
+        return true;
+    }
+
+    std::ifstream file(cachePath, std::ios::binary);
+    uint32_t version = 0;
+    std::vector<char> stored;
+    return !ReadHeader(file, version, stored) || stored != SerializeSettings(settings).data;
+}
@@ -0,0 +1,196 @@
+#include "meshCleaner.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+#include <glm/gtc/type_precision.hpp>
+
+namespace {
+
+glm::vec3 PositionOf(const Vertex& v) {
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+uint64_t CellKey(int64_t x, int64_t y, int64_t z) {
+    // Cells that collide only cost an extra distance test, never a wrong weld
+    const uint64_t mask = (uint64_t(1) << 21) - 1;
+    return (uint64_t(x) & mask) | ((uint64_t(y) & mask) << 21) | ((uint64_t(z) & mask) << 42);
+}
+
+// Three vertex indices rotated so the smallest comes first, keeping the winding
+struct TriangleKey {
+    unsigned int a, b, c;
+
+    bool operator==(const TriangleKey& other) const {
+        return a == other.a && b == other.b && c == other.c;
+    }
+};
+
+struct TriangleKeyHash {
+    size_t operator()(const TriangleKey& key) const {
+        size_t h = std::hash<unsigned int>()(key.a);
+        h ^= std::hash<unsigned int>()(key.b) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<unsigned int>()(key.c) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+TriangleKey MakeTriangleKey(unsigned int a, unsigned int b, unsigned int c) {
+    if (b < a && b < c) {
+        return { b, c, a };
+    }
+    if (c < a && c < b) {
+        return { c, a, b };
+    }
+    return { a, b, c };
+}
+
+} // namespace
+
+MeshCleanReport CleanMesh(Mesh& mesh, const MeshCleanOptions& options) {
+    MeshCleanReport report;
+    std::vector<Vertex>& vertices = mesh.vertices;
+    std::vector<unsigned int>& indices = mesh.indices;
+    size_t vertexCount = vertices.size();
+    if (vertexCount == 0) {
+        return report;
+    }
+
+    glm::vec3 minimum = PositionOf(vertices[0]), maximum = minimum;
+    for (const Vertex& v : vertices) {
+        minimum = glm::min(minimum, PositionOf(v));
+        maximum = glm::max(maximum, PositionOf(v));
+    }
+    float diagonal = glm::length(maximum - minimum);
+    float weldDistance = options.weldDistance * diagonal;
+    float cellSize = weldDistance > 0.0f ? weldDistance : 1.0f;
+
+    // Bucket vertices by grid cell; sorting by (cell, index) keeps the buckets deterministic
+    std::vector<std::pair<uint64_t, unsigned int>> cells(vertexCount);
+    std::vector<glm::i64vec3> vertexCells(vertexCount);
+    ParallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            glm::vec3 cell = glm::floor((PositionOf(vertices[v]) - minimum) / cellSize);
+            vertexCells[v] = glm::i64vec3(cell);
+            cells[v] = { CellKey(vertexCells[v].x, vertexCells[v].y, vertexCells[v].z), static_cast<unsigned int>(v) };
+        }
+    }, options.threads);
+    std::sort(cells.begin(), cells.end());
+
+    auto matches = [&](const Vertex& a, const Vertex& b) {
+        glm::vec3 d = PositionOf(a) - PositionOf(b);
+        if (glm::dot(d, d) > weldDistance * weldDistance) {
+            return false;
+        }
+        float e = options.attributeEpsilon;
+        return std::abs(a.tx - b.tx) <= e && std::abs(a.ty - b.ty) <= e &&
+            std::abs(a.nx - b.nx) <= e && std::abs(a.ny - b.ny) <= e && std::abs(a.nz - b.nz) <= e;
+    };
+
+    // Each vertex looks for the lowest earlier vertex it can merge with in the 27 surrounding cells
+    std::vector<unsigned int> target(vertexCount);
+    ParallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            unsigned int best = static_cast<unsigned int>(v);
+            glm::i64vec3 c = vertexCells[v];
+            for (int64_t dz = -1; dz <= 1; ++dz) {
+                for (int64_t dy = -1; dy <= 1; ++dy) {
+                    for (int64_t dx = -1; dx <= 1; ++dx) {
+                        uint64_t key = CellKey(c.x + dx, c.y + dy, c.z + dz);
+                        auto it = std::lower_bound(cells.begin(), cells.end(), std::make_pair(key, 0u));
+                        for (; it != cells.end() && it->first == key && it->second < best; ++it) {
+                            if (matches(vertices[it->second], vertices[v])) {
+                                best = it->second;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            target[v] = best;
+        }
+    }, options.threads);
+
+    // Follow merge chains in index order so every vertex lands on a vertex that maps to itself
+    std::vector<unsigned int> remap(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        remap[v] = target[v] == v ? static_cast<unsigned int>(v) : remap[target[v]];
+        if (remap[v] != v) {
+            report.weldedVertices++;
+        }
+    }
+
+    size_t triangleCount = indices.size() / 3;
+    float minDoubleArea = weldDistance * weldDistance;
+    std::vector<unsigned char> degenerate(triangleCount, 0);
+    ParallelFor(triangleCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            unsigned int* tri = &indices[t * 3];
+            tri[0] = remap[tri[0]];
+            tri[1] = remap[tri[1]];
+            tri[2] = remap[tri[2]];
+            if (!options.removeDegenerates) {
+                continue;
+            }
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) {
+                degenerate[t] = 1;
+                continue;
+            }
+            glm::vec3 p0 = PositionOf(vertices[tri[0]]);
+            glm::vec3 cross = glm::cross(PositionOf(vertices[tri[1]]) - p0, PositionOf(vertices[tri[2]]) - p0);
+            degenerate[t] = glm::length(cross) <= minDoubleArea ? 1 : 0;
+        }
+    }, options.threads);
+
+    // Keep the first occurrence of each triangle; opposite windings are distinct faces
+    std::unordered_set<TriangleKey, TriangleKeyHash> seen;
+    size_t kept = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        unsigned int a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+        if (degenerate[t]) {
+            report.degenerateTriangles++;
+            continue;
+        }
+        if (options.removeDuplicates && !seen.insert(MakeTriangleKey(a, b, c)).second) {
+            report.duplicateTriangles++;
+            continue;
+        }
+        indices[kept * 3] = a;
+        indices[kept * 3 + 1] = b;
+        indices[kept * 3 + 2] = c;
+        kept++;
+    }
+    indices.resize(kept * 3);
+
+    // Compact the vertices that are still referenced, keeping their relative order
+    std::vector<unsigned int> compact(vertexCount, 0);
+    for (unsigned int index : indices) {
+        compact[index] = 1;
+    }
+    bool hasTangents = mesh.tangents.size() == vertexCount;
+    size_t next = 0;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (!compact[v]) {
+            continue;
+        }
+        vertices[next] = vertices[v];
+        if (hasTangents) {
+            mesh.tangents[next] = mesh.tangents[v];
+        }
+        compact[v] = static_cast<unsigned int>(next++);
+    }
+    report.unreferencedVertices = vertexCount - next;
+    vertices.resize(next);
+    if (hasTangents) {
+        mesh.tangents.resize(next);
+    }
+
+    ParallelFor(indices.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            indices[i] = compact[indices[i]];
+        }
+    }, options.threads);
+
+    return report;
+}
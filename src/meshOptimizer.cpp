@@ -0,0 +1,349 @@
+#include "meshOptimizer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+
+// Forsyth scoring parameters (https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html)
+const size_t kForsythCacheSize = 32;
+const float kCacheDecayPower = 1.5f;
+const float kLastTriangleScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+
+const unsigned int kInvalidIndex = ~0u;
+
+float ForsythVertexScore(int cachePosition, unsigned int liveTriangles) {
+    // Vertices without remaining triangles should never attract the search
+    if (liveTriangles == 0) {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The last triangle's vertices get a fixed score so the next triangle does not just reuse them
+            score = kLastTriangleScore;
+        }
+        else {
+            float scaler = 1.0f / static_cast<float>(kForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+        }
+    }
+
+    // Boost vertices with few remaining triangles so lone triangles are not left behind
+    score += kValenceBoostScale * std::pow(static_cast<float>(liveTriangles), -kValenceBoostPower);
+    return score;
+}
+
+// Simple FIFO cache simulation that reports whether a vertex was a miss
+struct FifoCache {
+    std::vector<unsigned int> timestamps;
+    unsigned int time;
+    unsigned int size;
+
+    FifoCache(size_t vertexCount, unsigned int cacheSize)
+        : timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+    bool Miss(unsigned int vertex) {
+        if (time - timestamps[vertex] > size) {
+            timestamps[vertex] = time++;
+            return true;
+        }
+        return false;
+    }
+
+    unsigned int Triangle(const unsigned int* tri) {
+        return Miss(tri[0]) + Miss(tri[1]) + Miss(tri[2]);
+    }
+
+    void Reset() {
+        time += size + 1;
+    }
+};
+
+glm::vec3 PositionOf(const Vertex& v) {
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats = { 0.0f, 0.0f };
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<char> referenced(vertexCount, 0);
+    size_t misses = 0, uniqueVertices = 0;
+
+    for (size_t i = 0; i < triangleCount * 3; i += 3) {
+        misses += cache.Triangle(&indices[i]);
+        for (size_t k = 0; k < 3; ++k) {
+            if (!referenced[indices[i + k]]) {
+                referenced[indices[i + k]] = 1;
+                ++uniqueVertices;
+            }
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(triangleCount);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Build vertex -> triangle adjacency; each vertex keeps its live triangles at the front of its range
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        liveTriangles[indices[i]]++;
+    }
+
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    }
+
+    std::vector<unsigned int> adjacency(triangleCount * 3);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (size_t k = 0; k < 3; ++k) {
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = ForsythVertexScore(-1, liveTriangles[v]);
+    }
+
+    auto triangleScore = [&](size_t t) {
+        return vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    };
+
+    std::vector<char> emitted(triangleCount, 0);
+    unsigned int bestTriangle = 0;
+    float bestScore = triangleScore(0);
+    for (size_t t = 1; t < triangleCount; ++t) {
+        float score = triangleScore(t);
+        if (score > bestScore) {
+            bestScore = score;
+            bestTriangle = static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(kForsythCacheSize + 3);
+    nextCache.reserve(kForsythCacheSize + 3);
+
+    std::vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        // Nothing in the cache has live triangles left, so restart from the next unused triangle
+        if (bestTriangle == kInvalidIndex) {
+            while (emitted[scanCursor]) {
+                ++scanCursor;
+            }
+            bestTriangle = static_cast<unsigned int>(scanCursor);
+        }
+
+        const unsigned int* tri = &indices[bestTriangle * 3];
+        result.insert(result.end(), tri, tri + 3);
+        emitted[bestTriangle] = 1;
+
+        // Remove the triangle from its vertices' live lists
+        for (size_t k = 0; k < 3; ++k) {
+            unsigned int v = tri[k];
+            unsigned int* begin = &adjacency[offsets[v]];
+            unsigned int* end = begin + liveTriangles[v];
+            unsigned int* found = std::find(begin, end, bestTriangle);
+            std::swap(*found, *(end - 1));
+            liveTriangles[v]--;
+        }
+
+        // The emitted triangle moves to the front of the LRU cache
+        nextCache.assign(tri, tri + 3);
+        for (unsigned int v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2]) {
+                nextCache.push_back(v);
+            }
+        }
+        cache.swap(nextCache);
+
+        for (size_t i = 0; i < cache.size(); ++i) {
+            unsigned int v = cache[i];
+            cachePosition[v] = i < kForsythCacheSize ? static_cast<int>(i) : -1;
+            vertexScore[v] = ForsythVertexScore(cachePosition[v], liveTriangles[v]);
+        }
+
+        // Pick the best live triangle among those touching the cache
+        bestTriangle = kInvalidIndex;
+        bestScore = -1.0f;
+        for (unsigned int v : cache) {
+            if (cachePosition[v] < 0) {
+                continue;
+            }
+            for (unsigned int i = 0; i < liveTriangles[v]; ++i) {
+                unsigned int t = adjacency[offsets[v] + i];
+                float score = triangleScore(t);
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (cache.size() > kForsythCacheSize) {
+            cache.resize(kForsythCacheSize);
+        }
+    }
+
+    indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold) {
+    // Cluster-based sort from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander et al.)
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    const unsigned int cacheSize = 16;
+    FifoCache cache(vertices.size(), cacheSize);
+
+    // Hard boundaries: triangles that miss on every vertex, where the cache effectively restarts
+    std::vector<size_t> hardClusters;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (cache.Triangle(&indices[t * 3]) == 3) {
+            hardClusters.push_back(t);
+        }
+    }
+    if (hardClusters.empty() || hardClusters[0] != 0) {
+        hardClusters.insert(hardClusters.begin(), 0);
+    }
+
+    // Soft boundaries: split hard clusters wherever the running ACMR already matches the cluster target
+    std::vector<size_t> clusters;
+    for (size_t c = 0; c < hardClusters.size(); ++c) {
+        size_t start = hardClusters[c];
+        size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCount;
+
+        cache.Reset();
+        size_t clusterMisses = 0;
+        for (size_t t = start; t < end; ++t) {
+            clusterMisses += cache.Triangle(&indices[t * 3]);
+        }
+        float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+        clusters.push_back(start);
+        cache.Reset();
+        size_t runningMisses = 0, runningTriangles = 0;
+        for (size_t t = start; t < end; ++t) {
+            runningMisses += cache.Triangle(&indices[t * 3]);
+            runningTriangles++;
+            if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold) {
+                clusters.push_back(t + 1);
+                cache.Reset();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+
+        // The trailing split is usually a poor cluster (or empty), so merge it with the previous one
+        if (clusters.back() != start) {
+            clusters.pop_back();
+        }
+    }
+
+    // Sort key: how far the cluster faces away from the mesh centroid; outward-facing clusters occlude more
+    glm::vec3 meshCentroid(0.0f);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        meshCentroid += PositionOf(vertices[indices[i]]);
+    }
+    meshCentroid /= static_cast<float>(triangleCount * 3);
+
+    size_t clusterCount = clusters.size();
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        size_t start = clusters[c];
+        size_t end = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = start; t < end; ++t) {
+            glm::vec3 a = PositionOf(vertices[indices[t * 3]]);
+            glm::vec3 b = PositionOf(vertices[indices[t * 3 + 1]]);
+            glm::vec3 c2 = PositionOf(vertices[indices[t * 3 + 2]]);
+            glm::vec3 n = glm::cross(b - a, c2 - a);
+            float triangleArea = glm::length(n);
+            centroid += (a + b + c2) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+
+        centroid = area > 0.0f ? centroid / area : meshCentroid;
+        float normalLength = glm::length(normal);
+        normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+        sortKey[c] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        size_t start = clusters[c];
+        size_t end = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+
+    indices.swap(result);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    std::vector<unsigned int> remap(vertices.size(), kInvalidIndex);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (unsigned int& index : indices) {
+        if (remap[index] == kInvalidIndex) {
+            remap[index] = static_cast<unsigned int>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices.swap(result);
+}
+
+MeshOptimizeReport OptimizeMesh(Mesh& mesh, const MeshOptimizeOptions& options) {
+    MeshOptimizeReport report;
+    report.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), options.cacheSize);
+
+    if (options.vertexCache) {
+        OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    }
+    if (options.overdraw) {
+        OptimizeOverdraw(mesh.indices, mesh.vertices, options.overdrawThreshold);
+    }
+    if (options.vertexFetch) {
+        OptimizeVertexFetch(mesh.vertices, mesh.indices);
+    }
+
+    report.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size(), options.cacheSize);
+    return report;
+}
@@ -0,0 +1,380 @@
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// Symmetric 4x4 quadric (Garland & Heckbert) with the accumulated area weight
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double weight = 0;
+
+    static Quadric FromPlane(const glm::dvec3& n, double d, double w) {
+        Quadric q;
+        q.a00 = w * n.x * n.x; q.a01 = w * n.x * n.y; q.a02 = w * n.x * n.z;
+        q.a11 = w * n.y * n.y; q.a12 = w * n.y * n.z; q.a22 = w * n.z * n.z;
+        q.b0 = w * n.x * d; q.b1 = w * n.y * d; q.b2 = w * n.z * d;
+        q.c = w * d * d;
+        q.weight = w;
+        return q;
+    }
+
+    void Add(const Quadric& q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02;
+        a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+    }
+
+    // Area-weighted squared distance of p to the accumulated planes
+    double Eval(const glm::dvec3& p) const {
+        double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+            + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+            + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z)
+            + c;
+        return r > 0.0 ? r : 0.0;
+    }
+};
+
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    float error;
+};
+
+struct PositionHash {
+    size_t operator()(const glm::vec3& p) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+glm::dvec3 PositionOf(const Vertex& v) {
+    return glm::dvec3(v.x, v.y, v.z);
+}
+
+const unsigned int kNoPartner = 0xffffffffu;
+
+bool SameTexCoord(const Vertex& a, const Vertex& b) {
+    return a.tx == b.tx && a.ty == b.ty;
+}
+
+uint64_t EdgeKey(unsigned int a, unsigned int b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+} // namespace
+
+std::vector<unsigned int> SimplifyMesh(
+    const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float targetError, float* resultError,
+    std::vector<EdgeCollapseRecord>* collapseLog)
+{
+    size_t vertexCount = vertices.size();
+    std::vector<unsigned int> result = indices;
+    float maxError = 0.0f;
+
+    // Vertices sharing a position collapse together; this maps each vertex to the first one at its position
+    std::vector<unsigned int> remap(vertexCount);
+    std::unordered_map<glm::vec3, unsigned int, PositionHash> positionLookup;
+    positionLookup.reserve(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        glm::vec3 p(vertices[v].x, vertices[v].y, vertices[v].z);
+        auto inserted = positionLookup.emplace(p, static_cast<unsigned int>(v));
+        remap[v] = inserted.first->second;
+    }
+
+    // Members of each position group; a group of several vertices sits on an attribute seam
+    std::vector<unsigned int> groupOffsets(vertexCount + 1, 0);
+    std::vector<unsigned int> groupMembers(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        groupOffsets[remap[v] + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; ++v) {
+        groupOffsets[v + 1] += groupOffsets[v];
+    }
+    {
+        std::vector<unsigned int> fill(groupOffsets.begin(), groupOffsets.end() - 1);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            groupMembers[fill[remap[v]]++] = static_cast<unsigned int>(v);
+        }
+    }
+
+    // Lock border and non-manifold vertices; seams collapse as a whole group instead
+    std::vector<char> locked(vertexCount, 0);
+
+    std::unordered_map<uint64_t, unsigned int> edgeUse;
+    edgeUse.reserve(result.size());
+    for (size_t i = 0; i < result.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            edgeUse[EdgeKey(remap[result[i + k]], remap[result[i + (k + 1) % 3]])]++;
+        }
+    }
+    for (const auto& edge : edgeUse) {
+        if (edge.second != 2) {
+            locked[edge.first >> 32] = 1;
+            locked[edge.first & 0xffffffffu] = 1;
+        }
+    }
+
+    // Accumulate area-weighted plane quadrics per position
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        glm::dvec3 a = PositionOf(vertices[result[i]]);
+        glm::dvec3 b = PositionOf(vertices[result[i + 1]]);
+        glm::dvec3 c = PositionOf(vertices[result[i + 2]]);
+        glm::dvec3 n = glm::cross(b - a, c - a);
+        double length = glm::length(n);
+        if (length <= 0.0) {
+            continue;
+        }
+        n /= length;
+        Quadric q = Quadric::FromPlane(n, -glm::dot(n, a), length * 0.5);
+        for (size_t k = 0; k < 3; ++k) {
+            quadrics[remap[result[i + k]]].Add(q);
+        }
+    }
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> collapseTarget(vertexCount);
+    std::vector<char> collapseLocked(vertexCount);
+    std::vector<Collapse> collapses;
+    std::vector<Collapse> moves;
+
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        // Vertex -> triangle adjacency for the current index buffer
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (unsigned int index : result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // Each directed triangle edge proposes moving its first vertex onto the second
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (size_t k = 0; k < 3; ++k) {
+                unsigned int from = result[i + k];
+                unsigned int to = result[i + (k + 1) % 3];
+                unsigned int groupFrom = remap[from], groupTo = remap[to];
+                if (locked[groupFrom] || groupFrom == groupTo) {
+                    continue;
+                }
+
+                Quadric q = quadrics[groupFrom];
+                q.Add(quadrics[groupTo]);
+                double cost = q.weight > 0.0 ? q.Eval(PositionOf(vertices[to])) / q.weight : 0.0;
+                collapses.push_back({ from, to, static_cast<float>(std::sqrt(cost)) });
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        for (size_t v = 0; v < vertexCount; ++v) {
+            collapseTarget[v] = static_cast<unsigned int>(v);
+        }
+        std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+
+        size_t triangleGoal = (result.size() - targetIndexCount) / 3;
+        size_t removedTriangles = 0;
+        size_t performed = 0;
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > targetError || removedTriangles >= triangleGoal) {
+                break;
+            }
+
+            unsigned int groupFrom = remap[collapse.from], groupTo = remap[collapse.to];
+            if (collapseLocked[groupFrom] || collapseLocked[groupTo]) {
+                continue;
+            }
+
+            // Every vertex of the group still in use moves onto a vertex of the target group. One sharing an edge
+            // with it is taken first; that also fixes where its texture coordinates go, so the other corners at
+            // the position follow those along the same UV chart, keeping the closest normal. Corners whose chart
+            // has no edge to the target, or charts that would go two ways, mean the seam turns away here.
+            moves.clear();
+            bool valid = true;
+            for (unsigned int m = groupOffsets[groupFrom]; m < groupOffsets[groupFrom + 1] && valid; ++m) {
+                unsigned int from = groupMembers[m];
+                if (adjacencyOffsets[from] == adjacencyOffsets[from + 1]) {
+                    continue;
+                }
+                unsigned int partner = kNoPartner;
+                for (unsigned int a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && valid; ++a) {
+                    const unsigned int* tri = &result[adjacency[a] * 3];
+                    for (size_t k = 0; k < 3; ++k) {
+                        if (remap[tri[k]] == groupTo) {
+                            valid = partner == kNoPartner || partner == tri[k];
+                            partner = tri[k];
+                        }
+                    }
+                }
+                moves.push_back({ from, partner, collapse.error });
+            }
+            for (Collapse& move : moves) {
+                if (!valid || move.to != kNoPartner) {
+                    continue;
+                }
+                // Where the edge-sharing corners with the same texture coordinates are headed
+                const Vertex& source = vertices[move.from];
+                const Vertex* chartTarget = nullptr;
+                for (const Collapse& other : moves) {
+                    if (other.to != kNoPartner && SameTexCoord(vertices[other.from], source)) {
+                        const Vertex& candidate = vertices[other.to];
+                        valid = valid && (!chartTarget || SameTexCoord(*chartTarget, candidate));
+                        chartTarget = &candidate;
+                    }
+                }
+                valid = valid && chartTarget;
+                double bestDot = -2.0;
+                for (unsigned int m = groupOffsets[groupTo]; m < groupOffsets[groupTo + 1] && valid; ++m) {
+                    const Vertex& candidate = vertices[groupMembers[m]];
+                    double d = source.nx * candidate.nx + source.ny * candidate.ny + source.nz * candidate.nz;
+                    if (SameTexCoord(candidate, *chartTarget) && d > bestDot) {
+                        bestDot = d;
+                        move.to = groupMembers[m];
+                    }
+                }
+                valid = valid && move.to != kNoPartner;
+            }
+            if (!valid || moves.empty()) {
+                continue;
+            }
+
+            // Reject collapses that would flip any triangle that survives around the moved vertices
+            glm::dvec3 target = PositionOf(vertices[collapse.to]);
+            bool flips = false;
+            size_t removedHere = 0;
+            for (const Collapse& move : moves) {
+                for (unsigned int a = adjacencyOffsets[move.from]; a < adjacencyOffsets[move.from + 1] && !flips; ++a) {
+                    const unsigned int* tri = &result[adjacency[a] * 3];
+                    if (remap[tri[0]] == groupTo || remap[tri[1]] == groupTo || remap[tri[2]] == groupTo) {
+                        removedHere++;
+                        continue;
+                    }
+
+                    glm::dvec3 p[3], moved[3];
+                    for (size_t k = 0; k < 3; ++k) {
+                        p[k] = PositionOf(vertices[tri[k]]);
+                        moved[k] = tri[k] == move.from ? target : p[k];
+                    }
+                    glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    flips = glm::dot(before, after) <= 0.0;
+                }
+            }
+            if (flips) {
+                continue;
+            }
+
+            quadrics[groupTo].Add(quadrics[groupFrom]);
+            for (const Collapse& move : moves) {
+                collapseTarget[move.from] = move.to;
+                if (collapseLog) {
+                    collapseLog->push_back({ move.from, move.to, move.error });
+                }
+
+                // Keep the one-ring stable for the rest of this pass so flip checks stay valid
+                for (unsigned int a = adjacencyOffsets[move.from]; a < adjacencyOffsets[move.from + 1]; ++a) {
+                    const unsigned int* tri = &result[adjacency[a] * 3];
+                    collapseLocked[remap[tri[0]]] = 1;
+                    collapseLocked[remap[tri[1]]] = 1;
+                    collapseLocked[remap[tri[2]]] = 1;
+                }
+            }
+            maxError = std::max(maxError, collapse.error);
+            removedTriangles += removedHere;
+            performed++;
+        }
+
+        if (performed == 0) {
+            break;
+        }
+
+        // Apply the collapses and drop triangles that became degenerate
+        size_t write = 0;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            unsigned int a = collapseTarget[result[t * 3]];
+            unsigned int b = collapseTarget[result[t * 3 + 1]];
+            unsigned int c = collapseTarget[result[t * 3 + 2]];
+            if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) {
+                continue;
+            }
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (resultError) {
+        *resultError = maxError;
+    }
+    return result;
+}
+
+void BuildLodChain(Mesh& mesh, const LodChainOptions& options) {
+    mesh.lods.clear();
+    mesh.lodIndices.clear();
+    if (mesh.vertices.empty() || mesh.indices.empty()) {
+        return;
+    }
+
+    // Bounding sphere used for error scaling and distance-based selection
+    glm::vec3 minPos(mesh.vertices[0].x, mesh.vertices[0].y, mesh.vertices[0].z), maxPos = minPos;
+    for (const Vertex& v : mesh.vertices) {
+        minPos = glm::min(minPos, glm::vec3(v.x, v.y, v.z));
+        maxPos = glm::max(maxPos, glm::vec3(v.x, v.y, v.z));
+    }
+    mesh.boundsCenter = (minPos + maxPos) * 0.5f;
+    mesh.boundsRadius = 0.0f;
+    for (const Vertex& v : mesh.vertices) {
+        mesh.boundsRadius = std::max(mesh.boundsRadius, glm::length(glm::vec3(v.x, v.y, v.z) - mesh.boundsCenter));
+    }
+
+    // Level 0 is the full detail index buffer
+    mesh.lods.push_back({ 0, static_cast<unsigned int>(mesh.indices.size()), 0.0f });
+
+    std::vector<unsigned int> previous = mesh.indices;
+    for (float relativeError : options.errorTargets) {
+        size_t target = static_cast<size_t>(previous.size() / 3 * options.reduction) * 3;
+        float error = 0.0f;
+        std::vector<unsigned int> lod = SimplifyMesh(mesh.vertices, previous, target, relativeError * mesh.boundsRadius, &error);
+
+        // A tight target may barely reduce the mesh; the next, looser target gets a go instead
+        if (lod.empty() || lod.size() > previous.size() * options.minReduction) {
+            continue;
+        }
+        OptimizeVertexCache(lod, mesh.vertices.size());
+
+        MeshLod level;
+        level.indexOffset = static_cast<unsigned int>(mesh.indices.size() + mesh.lodIndices.size());
+        level.indexCount = static_cast<unsigned int>(lod.size());
+        level.error = mesh.lods.back().error + error; // Errors of successive levels can stack
+        mesh.lods.push_back(level);
+        mesh.lodIndices.insert(mesh.lodIndices.end(), lod.begin(), lod.end());
+        previous.swap(lod);
+    }
+}
@@ -0,0 +1,162 @@
+#include <glad/glad.h>
+#include "meshlets.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+glm::vec3 PositionOf(const Vertex& v) {
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+// Bounding sphere and normal cone of the meshlet's triangles
+void ComputeMeshletBounds(const Mesh& mesh, Meshlet& meshlet, const std::vector<unsigned int>& meshletVertices) {
+    glm::vec3 minPos = PositionOf(mesh.vertices[meshletVertices[0]]), maxPos = minPos;
+    for (unsigned int v : meshletVertices) {
+        minPos = glm::min(minPos, PositionOf(mesh.vertices[v]));
+        maxPos = glm::max(maxPos, PositionOf(mesh.vertices[v]));
+    }
+    meshlet.center = (minPos + maxPos) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (unsigned int v : meshletVertices) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(PositionOf(mesh.vertices[v]) - meshlet.center));
+    }
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.indexCount / 3);
+    glm::vec3 axis(0.0f);
+    for (unsigned int i = 0; i < meshlet.indexCount; i += 3) {
+        const unsigned int* tri = &mesh.indices[meshlet.indexOffset + i];
+        glm::vec3 a = PositionOf(mesh.vertices[tri[0]]);
+        glm::vec3 b = PositionOf(mesh.vertices[tri[1]]);
+        glm::vec3 c = PositionOf(mesh.vertices[tri[2]]);
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length > 0.0f) {
+            normals.push_back(n / length);
+            axis += n / length;
+        }
+    }
+
+    // Clusters whose normals spread over a hemisphere can't be rejected by facing
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals) {
+        minDot = std::min(minDot, glm::dot(n, axis));
+    }
+    meshlet.coneAxis = axis;
+    if (minDot > 0.1f) {
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+} // namespace
+
+void BuildMeshlets(Mesh& mesh) {
+    mesh.meshlets.clear();
+    if (mesh.indices.empty()) {
+        return;
+    }
+
+    // Greedy scan in index order; the vertex cache optimized order keeps clusters spatially coherent, so each
+    // meshlet is a consecutive run of the full detail indices and needs no copy of its own
+    const unsigned int kUnused = ~0u;
+    std::vector<unsigned int> owner(mesh.vertices.size(), kUnused);
+    std::vector<unsigned int> meshletVertices;
+    Meshlet current = {};
+
+    auto flush = [&]() {
+        if (current.indexCount == 0) {
+            return;
+        }
+        current.vertexCount = static_cast<unsigned int>(meshletVertices.size());
+        ComputeMeshletBounds(mesh, current, meshletVertices);
+        mesh.meshlets.push_back(current);
+
+        unsigned int next = current.indexOffset + current.indexCount;
+        current = {};
+        current.indexOffset = next;
+        meshletVertices.clear();
+    };
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const unsigned int* tri = &mesh.indices[i];
+        unsigned int id = static_cast<unsigned int>(mesh.meshlets.size());
+
+        size_t newVertices = (owner[tri[0]] != id) + (owner[tri[1]] != id && tri[1] != tri[0])
+            + (owner[tri[2]] != id && tri[2] != tri[0] && tri[2] != tri[1]);
+        if (meshletVertices.size() + newVertices > MESHLET_MAX_VERTICES || current.indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES) {
+            flush();
+            id = static_cast<unsigned int>(mesh.meshlets.size());
+        }
+
+        for (size_t k = 0; k < 3; ++k) {
+            if (owner[tri[k]] != id) {
+                owner[tri[k]] = id;
+                meshletVertices.push_back(tri[k]);
+            }
+        }
+        current.indexCount += 3;
+    }
+    flush();
+}
+
+size_t CullMeshlets(
+    const Mesh& mesh, const glm::mat4& model, const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+    std::vector<int>& counts, std::vector<const void*>& offsets)
+{
+    // Frustum planes extracted from the model-view-projection matrix are in object space
+    glm::mat4 mvp = viewProjection * model;
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; ++r) {
+        rows[r] = glm::vec4(mvp[0][r], mvp[1][r], mvp[2][r], mvp[3][r]);
+    }
+    glm::vec4 planes[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[3] + rows[2], rows[3] - rows[2]
+    };
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
+    glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    size_t indexSize = mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    size_t culled = 0;
+
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        bool visible = true;
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) {
+                visible = false;
+                break;
+            }
+        }
+
+        // Every triangle faces away when the view direction lies inside the cone around the axis
+        if (visible && meshlet.coneCutoff < 1.0f) {
+            glm::vec3 toCenter = meshlet.center - camera;
+            if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius) {
+                visible = false;
+            }
+        }
+
+        if (!visible) {
+            culled++;
+            continue;
+        }
+
+        counts.push_back(static_cast<int>(meshlet.indexCount));
+        offsets.push_back((const void*)((mesh.indexBase + meshlet.indexOffset) * indexSize));
+    }
+
+    return culled;
+}
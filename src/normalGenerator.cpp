@@ -0,0 +1,95 @@
+#include "normalGenerator.h"
+#include "parallel.h"
+#include <cmath>
+
+namespace {
+
+float AngleBetween(const glm::vec3& a, const glm::vec3& b) {
+    float la = glm::length(a), lb = glm::length(b);
+    if (la <= 0.0f || lb <= 0.0f) {
+        return 0.0f;
+    }
+    return std::acos(glm::clamp(glm::dot(a, b) / (la * lb), -1.0f, 1.0f));
+}
+
+} // namespace
+
+std::vector<glm::vec3> GenerateCornerNormals(
+    const std::vector<glm::vec3>& positions,
+    const std::vector<unsigned int>& cornerPositions,
+    const std::vector<unsigned int>& smoothingGroups,
+    const NormalGenerationOptions& options)
+{
+    size_t cornerCount = cornerPositions.size();
+    size_t triangleCount = cornerCount / 3;
+
+    // Per-triangle unit normal and area, per-corner interior angle
+    std::vector<glm::vec3> faceNormals(triangleCount);
+    std::vector<float> faceAreas(triangleCount);
+    std::vector<float> cornerAngles(cornerCount);
+    ParallelFor(triangleCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            glm::vec3 p0 = positions[cornerPositions[t * 3]];
+            glm::vec3 p1 = positions[cornerPositions[t * 3 + 1]];
+            glm::vec3 p2 = positions[cornerPositions[t * 3 + 2]];
+
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(n);
+            faceNormals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+            faceAreas[t] = length * 0.5f;
+
+            cornerAngles[t * 3] = AngleBetween(p1 - p0, p2 - p0);
+            cornerAngles[t * 3 + 1] = AngleBetween(p2 - p1, p0 - p1);
+            cornerAngles[t * 3 + 2] = AngleBetween(p0 - p2, p1 - p2);
+        }
+    }, options.threads);
+
+    // Position -> corners adjacency, filled in corner order so every gather sums in a fixed order
+    std::vector<unsigned int> offsets(positions.size() + 1, 0);
+    for (unsigned int p : cornerPositions) {
+        offsets[p + 1]++;
+    }
+    for (size_t p = 0; p < positions.size(); ++p) {
+        offsets[p + 1] += offsets[p];
+    }
+    std::vector<unsigned int> corners(cornerCount);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t c = 0; c < cornerCount; ++c) {
+        corners[fill[cornerPositions[c]]++] = static_cast<unsigned int>(c);
+    }
+
+    float creaseCos = std::cos(glm::radians(options.creaseAngle));
+
+    // Each corner gathers the faces around its position that may be smoothed with its own face
+    std::vector<glm::vec3> normals(cornerCount);
+    ParallelFor(cornerCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            size_t t = c / 3;
+            unsigned int group = smoothingGroups[t];
+            glm::vec3 faceNormal = faceNormals[t];
+
+            glm::vec3 sum(0.0f);
+            if (group == SMOOTHING_GROUP_OFF) {
+                sum = faceNormal;
+            }
+            else {
+                unsigned int p = cornerPositions[c];
+                for (unsigned int i = offsets[p]; i < offsets[p + 1]; ++i) {
+                    unsigned int other = corners[i];
+                    size_t otherTriangle = other / 3;
+                    if (otherTriangle != t) {
+                        if (smoothingGroups[otherTriangle] != group || glm::dot(faceNormals[otherTriangle], faceNormal) < creaseCos) {
+                            continue;
+                        }
+                    }
+                    sum += faceNormals[otherTriangle] * (faceAreas[otherTriangle] * cornerAngles[other]);
+                }
+            }
+
+            float length = glm::length(sum);
+            normals[c] = length > 0.0f ? sum / length : faceNormal;
+        }
+    }, options.threads);
+
+    return normals;
+}
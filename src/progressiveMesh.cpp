@@ -0,0 +1,551 @@
+#include <glad/glad.h>
+#include "progressiveMesh.h"
+#include "meshSimplifier.h"
+#include "glState.h"
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+const char kMagic[4] = { 'R', 'L', 'P', 'M' };
+const uint32_t kVersion = 2;
+
+// Fixed part of the header: magic, version, five counts, format, quantization, bounds, base error and base ratio
+const size_t kHeaderSize = 4 + 4 + 5 * sizeof(uint32_t) + 4 + sizeof(VertexQuantization) + sizeof(glm::vec3) + 3 * sizeof(float);
+
+// Where the format bytes start in the header
+const size_t kFormatOffset = 4 + 4 + 5 * sizeof(uint32_t);
+
+// Triangle count, corner count and error ahead of each record's vertex
+const size_t kRecordHeaderSize = 2 * sizeof(uint32_t) + sizeof(float);
+
+const unsigned int kUnassigned = std::numeric_limits<unsigned int>::max();
+const size_t kAlive = std::numeric_limits<size_t>::max();
+
+struct PositionHash {
+    size_t operator()(const glm::vec3& p) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+template <typename T>
+void WriteValue(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void WriteValues(std::ofstream& file, const std::vector<T>& values) {
+    file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+void ReadValue(const char*& cursor, T& value) {
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+}
+
+void FormatBytes(const VertexFormat& format, uint8_t bytes[4]) {
+    bytes[0] = static_cast<uint8_t>(format.position);
+    bytes[1] = static_cast<uint8_t>(format.normal);
+    bytes[2] = static_cast<uint8_t>(format.texCoord);
+    bytes[3] = static_cast<uint8_t>(format.splitPositions ? 1 : 0);
+}
+
+size_t IndexSize(const Mesh& mesh) {
+    return mesh.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+// Parse the fixed header once enough bytes arrived; returns the bytes consumed
+size_t ParseHeader(ProgressiveMeshStream& stream) {
+    if (stream.pending.size() < kHeaderSize) {
+        return 0;
+    }
+
+    const char* cursor = stream.pending.data();
+    uint32_t version = 0, vertexCount = 0, triangleCount = 0, baseVertexCount = 0, baseTriangleCount = 0, recordCount = 0;
+    uint8_t format[4];
+    if (std::memcmp(cursor, kMagic, sizeof(kMagic)) != 0) {
+        stream.failed = true;
+        return 0;
+    }
+    cursor += sizeof(kMagic);
+    ReadValue(cursor, version);
+    ReadValue(cursor, vertexCount);
+    ReadValue(cursor, triangleCount);
+    ReadValue(cursor, baseVertexCount);
+    ReadValue(cursor, baseTriangleCount);
+    ReadValue(cursor, recordCount);
+    std::memcpy(format, cursor, sizeof(format));
+    cursor += sizeof(format);
+    ReadValue(cursor, stream.mesh.quantization);
+    ReadValue(cursor, stream.mesh.boundsCenter);
+    ReadValue(cursor, stream.mesh.boundsRadius);
+    ReadValue(cursor, stream.error);
+    cursor += sizeof(float); // Base ratio, only read by IsProgressiveMeshStale
+
+    if (version != kVersion || baseVertexCount + recordCount != vertexCount || baseTriangleCount > triangleCount) {
+        stream.failed = true;
+        return 0;
+    }
+
+    stream.mesh.format.position = static_cast<PositionFormat>(format[0]);
+    stream.mesh.format.normal = static_cast<NormalFormat>(format[1]);
+    stream.mesh.format.texCoord = static_cast<TexCoordFormat>(format[2]);
+    stream.mesh.format.splitPositions = format[3] != 0;
+    stream.totalVertices = vertexCount;
+    stream.totalTriangles = triangleCount;
+    stream.baseVertexCount = baseVertexCount;
+    stream.baseTriangleCount = baseTriangleCount;
+    stream.recordCount = recordCount;
+    stream.headerRead = true;
+    return kHeaderSize;
+}
+
+// Create full detail sized buffers so refinements only ever write into them
+void CreateStreamBuffers(ProgressiveMeshStream& stream) {
+    Mesh& mesh = stream.mesh;
+    VertexLayout layout = GetVertexLayout(mesh.format);
+    size_t vertexBytes = GetAttributeStreamOffset(mesh.format, stream.totalVertices) + stream.totalVertices * layout.stride;
+
+    glGenVertexArrays(1, &mesh.vao);
+    glGenBuffers(1, &mesh.vbo);
+    glGenBuffers(1, &stream.ebo);
+    CachedBindVertexArray(mesh.vao);
+
+    CachedBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, nullptr, GL_STATIC_DRAW);
+    SetupVertexAttributes(mesh.format, stream.totalVertices);
+
+    // The index type follows the full detail vertex count, like UploadIndices
+    mesh.indexType = stream.totalVertices < 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    CachedBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, stream.totalTriangles * 3 * IndexSize(mesh), nullptr, GL_STATIC_DRAW);
+
+    CachedBindVertexArray(0);
+}
+
+// Upload the vertices added and the index range changed since the last upload
+void UploadStreamChanges(ProgressiveMeshStream& stream) {
+    Mesh& mesh = stream.mesh;
+    if (stream.uploadedVertices < mesh.vertices.size()) {
+        std::vector<Vertex> added(mesh.vertices.begin() + stream.uploadedVertices, mesh.vertices.end());
+        std::vector<unsigned char> packed = PackVertices(added, mesh.format, mesh.quantization);
+        VertexLayout layout = GetVertexLayout(mesh.format);
+
+        CachedBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        if (mesh.format.splitPositions) {
+            // Both streams are placed for the full vertex count, so the new vertices land in two places
+            size_t positionBytes = added.size() * layout.positionStride;
+            glBufferSubData(GL_ARRAY_BUFFER, stream.uploadedVertices * layout.positionStride, positionBytes, packed.data());
+            glBufferSubData(GL_ARRAY_BUFFER,
+                GetAttributeStreamOffset(mesh.format, stream.totalVertices) + stream.uploadedVertices * layout.stride,
+                packed.size() - positionBytes, packed.data() + GetAttributeStreamOffset(mesh.format, added.size()));
+        }
+        else {
+            glBufferSubData(GL_ARRAY_BUFFER, stream.uploadedVertices * layout.stride, packed.size(), packed.data());
+        }
+        CachedBindBuffer(GL_ARRAY_BUFFER, 0);
+        stream.uploadedVertices = mesh.vertices.size();
+    }
+
+    if (stream.dirtyBegin < stream.dirtyEnd) {
+        size_t count = stream.dirtyEnd - stream.dirtyBegin;
+        size_t indexSize = IndexSize(mesh);
+
+        // The EBO binding is VAO state, so bind the VAO rather than disturb whatever else is bound
+        CachedBindVertexArray(mesh.vao);
+        if (mesh.indexType == GL_UNSIGNED_SHORT) {
+            std::vector<uint16_t> shortIndices(mesh.indices.begin() + stream.dirtyBegin, mesh.indices.begin() + stream.dirtyEnd);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, stream.dirtyBegin * indexSize, count * indexSize, shortIndices.data());
+        }
+        else {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, stream.dirtyBegin * indexSize, count * indexSize, mesh.indices.data() + stream.dirtyBegin);
+        }
+        CachedBindVertexArray(0);
+        stream.dirtyBegin = stream.dirtyEnd = 0;
+    }
+    mesh.indexCount = static_cast<unsigned int>(mesh.indices.size());
+}
+
+void MarkDirty(ProgressiveMeshStream& stream, size_t begin, size_t end) {
+    if (stream.dirtyBegin == stream.dirtyEnd) {
+        stream.dirtyBegin = begin;
+        stream.dirtyEnd = end;
+        return;
+    }
+    stream.dirtyBegin = std::min(stream.dirtyBegin, begin);
+    stream.dirtyEnd = std::max(stream.dirtyEnd, end);
+}
+
+// Parse the base mesh once all of it arrived; returns the bytes consumed
+size_t ParseBase(ProgressiveMeshStream& stream, const char* data, size_t size) {
+    size_t vertexBytes = stream.baseVertexCount * sizeof(Vertex);
+    size_t indexBytes = stream.baseTriangleCount * 3 * sizeof(uint32_t);
+    if (size < vertexBytes + indexBytes) {
+        return 0;
+    }
+
+    Mesh& mesh = stream.mesh;
+    mesh.vertices.resize(stream.baseVertexCount);
+    mesh.indices.resize(stream.baseTriangleCount * 3);
+    std::memcpy(mesh.vertices.data(), data, vertexBytes);
+    std::memcpy(mesh.indices.data(), data + vertexBytes, indexBytes);
+    for (unsigned int index : mesh.indices) {
+        if (index >= stream.baseVertexCount) {
+            stream.failed = true;
+            return 0;
+        }
+    }
+
+    CreateStreamBuffers(stream);
+    MarkDirty(stream, 0, mesh.indices.size());
+    return vertexBytes + indexBytes;
+}
+
+// Apply the next record if all of it arrived; returns the bytes consumed
+size_t ApplyRecord(ProgressiveMeshStream& stream, const char* data, size_t size) {
+    if (size < kRecordHeaderSize + sizeof(Vertex)) {
+        return 0;
+    }
+
+    const char* cursor = data;
+    uint32_t triangleCount = 0, cornerCount = 0;
+    float error = 0.0f;
+    ReadValue(cursor, triangleCount);
+    ReadValue(cursor, cornerCount);
+    ReadValue(cursor, error);
+
+    size_t recordSize = kRecordHeaderSize + sizeof(Vertex) + (static_cast<size_t>(triangleCount) * 3 + cornerCount) * sizeof(uint32_t);
+    if (size < recordSize) {
+        return 0;
+    }
+
+    Mesh& mesh = stream.mesh;
+    if (mesh.indices.size() + static_cast<size_t>(triangleCount) * 3 > stream.totalTriangles * 3) {
+        stream.failed = true;
+        return 0;
+    }
+
+    Vertex vertex;
+    ReadValue(cursor, vertex);
+    unsigned int newVertex = static_cast<unsigned int>(mesh.vertices.size());
+    mesh.vertices.push_back(vertex);
+
+    // Restored triangles go at the end, so the drawn range stays one prefix of the buffer
+    size_t first = mesh.indices.size();
+    mesh.indices.resize(first + static_cast<size_t>(triangleCount) * 3);
+    std::memcpy(mesh.indices.data() + first, cursor, static_cast<size_t>(triangleCount) * 3 * sizeof(uint32_t));
+    cursor += static_cast<size_t>(triangleCount) * 3 * sizeof(uint32_t);
+    for (size_t i = first; i < mesh.indices.size(); ++i) {
+        if (mesh.indices[i] > newVertex) {
+            stream.failed = true;
+            return 0;
+        }
+    }
+    if (first < mesh.indices.size()) {
+        MarkDirty(stream, first, mesh.indices.size());
+    }
+
+    for (uint32_t c = 0; c < cornerCount; ++c) {
+        uint32_t corner = 0;
+        ReadValue(cursor, corner);
+        if (corner >= mesh.indices.size()) {
+            stream.failed = true;
+            return 0;
+        }
+        mesh.indices[corner] = newVertex;
+        MarkDirty(stream, corner, corner + 1);
+    }
+
+    stream.error = error;
+    stream.recordsApplied++;
+    return recordSize;
+}
+
+} // namespace
+
+bool BuildProgressiveMesh(const Mesh& mesh, const ProgressiveMeshOptions& options, ProgressiveMeshData& data) {
+    size_t vertexCount = mesh.vertices.size();
+    size_t triangleCount = mesh.indices.size() / 3;
+    if (vertexCount == 0 || triangleCount == 0) {
+        std::cerr << "Error: Nothing to build a progressive mesh from" << std::endl;
+        return false;
+    }
+    std::vector<unsigned int> corners(mesh.indices.begin(), mesh.indices.begin() + triangleCount * 3);
+
+    // Simplify down to the base, logging every collapse in the order it was applied
+    std::vector<EdgeCollapseRecord> collapses;
+    size_t target = static_cast<size_t>(static_cast<float>(triangleCount) * std::max(options.baseRatio, 0.0f)) * 3;
+    SimplifyMesh(mesh.vertices, corners, target, std::numeric_limits<float>::max(), nullptr, &collapses);
+
+    // Position groups as in the simplifier: a triangle is gone once two corners share a position
+    std::vector<unsigned int> remap(vertexCount);
+    std::unordered_map<glm::vec3, unsigned int, PositionHash> positionLookup;
+    positionLookup.reserve(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        glm::vec3 p(mesh.vertices[v].x, mesh.vertices[v].y, mesh.vertices[v].z);
+        remap[v] = positionLookup.emplace(p, static_cast<unsigned int>(v)).first->second;
+    }
+    auto degenerate = [&](const unsigned int* tri) {
+        return remap[tri[0]] == remap[tri[1]] || remap[tri[1]] == remap[tri[2]] || remap[tri[0]] == remap[tri[2]];
+    };
+
+    // Replay the collapses one by one, recording which triangles each one removes and which corners it moves
+    std::vector<size_t> removedAt(triangleCount, kAlive);
+    std::vector<std::vector<unsigned int>> vertexTriangles(vertexCount);
+    std::vector<bool> dropped(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (degenerate(&corners[t * 3])) {
+            dropped[t] = true; // Already degenerate in the source; not worth restoring
+            continue;
+        }
+        for (size_t k = 0; k < 3; ++k) {
+            vertexTriangles[corners[t * 3 + k]].push_back(static_cast<unsigned int>(t));
+        }
+    }
+
+    std::vector<std::vector<unsigned int>> movedCorners(collapses.size());
+    std::vector<std::vector<unsigned int>> removedTriangles(collapses.size());
+    std::vector<unsigned int> removedCorners(triangleCount * 3);
+    for (size_t i = 0; i < collapses.size(); ++i) {
+        unsigned int from = collapses[i].from, to = collapses[i].to;
+        for (unsigned int t : vertexTriangles[from]) {
+            if (dropped[t] || removedAt[t] != kAlive) {
+                continue;
+            }
+            unsigned int* tri = &corners[t * 3];
+            unsigned int before[3] = { tri[0], tri[1], tri[2] };
+            for (size_t k = 0; k < 3; ++k) {
+                tri[k] = tri[k] == from ? to : tri[k];
+            }
+
+            if (degenerate(tri)) {
+                removedAt[t] = i;
+                removedTriangles[i].push_back(t);
+                std::copy(before, before + 3, &removedCorners[t * 3]);
+                continue;
+            }
+            for (size_t k = 0; k < 3; ++k) {
+                if (before[k] == from) {
+                    movedCorners[i].push_back(static_cast<unsigned int>(t * 3 + k));
+                }
+            }
+            vertexTriangles[to].push_back(t);
+        }
+        std::vector<unsigned int>().swap(vertexTriangles[from]);
+    }
+
+    // Base vertices in the order the base triangles first use them, then one vertex per record
+    std::vector<unsigned int> newIndex(vertexCount, kUnassigned);
+    std::vector<char> collapsed(vertexCount, 0);
+    for (const EdgeCollapseRecord& collapse : collapses) {
+        collapsed[collapse.from] = 1;
+    }
+
+    data = ProgressiveMeshData();
+    data.format = options.format;
+    data.baseRatio = options.baseRatio;
+    data.quantization = ComputeVertexQuantization(mesh.vertices, options.format);
+
+    std::vector<unsigned int> slot(triangleCount, kUnassigned);
+    unsigned int nextSlot = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (dropped[t] || removedAt[t] != kAlive) {
+            continue;
+        }
+        slot[t] = nextSlot++;
+        for (size_t k = 0; k < 3; ++k) {
+            unsigned int v = corners[t * 3 + k];
+            if (newIndex[v] == kUnassigned) {
+                newIndex[v] = static_cast<unsigned int>(data.baseVertices.size());
+                data.baseVertices.push_back(mesh.vertices[v]);
+            }
+            data.baseIndices.push_back(newIndex[v]);
+        }
+    }
+
+    // Vertices that lost all base triangles are still referenced once their triangles come back
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (size_t k = 0; k < 3 && !dropped[t]; ++k) {
+            unsigned int v = mesh.indices[t * 3 + k];
+            if (!collapsed[v] && newIndex[v] == kUnassigned) {
+                newIndex[v] = static_cast<unsigned int>(data.baseVertices.size());
+                data.baseVertices.push_back(mesh.vertices[v]);
+            }
+        }
+    }
+
+    // Error left after undoing collapse i is the largest error among the collapses before it
+    std::vector<float> errorBefore(collapses.size() + 1, 0.0f);
+    for (size_t i = 0; i < collapses.size(); ++i) {
+        errorBefore[i + 1] = std::max(errorBefore[i], collapses[i].error);
+    }
+    data.baseError = errorBefore[collapses.size()];
+
+    // Refinement undoes the collapses last to first, so the coarsest detail is restored first
+    unsigned int nextVertex = static_cast<unsigned int>(data.baseVertices.size());
+    data.records.resize(collapses.size());
+    for (size_t r = 0; r < collapses.size(); ++r) {
+        size_t i = collapses.size() - 1 - r;
+        ProgressiveRecord& record = data.records[r];
+        newIndex[collapses[i].from] = nextVertex++;
+        record.vertex = mesh.vertices[collapses[i].from];
+        record.error = errorBefore[i];
+
+        std::sort(removedTriangles[i].begin(), removedTriangles[i].end());
+        for (unsigned int t : removedTriangles[i]) {
+            slot[t] = nextSlot++;
+            for (size_t k = 0; k < 3; ++k) {
+                record.triangles.push_back(newIndex[removedCorners[t * 3 + k]]);
+            }
+        }
+        for (unsigned int corner : movedCorners[i]) {
+            record.corners.push_back(slot[corner / 3] * 3 + corner % 3);
+        }
+    }
+
+    // Bounding sphere of the full detail mesh, as BuildLodChain computes it
+    glm::vec3 minPos(mesh.vertices[0].x, mesh.vertices[0].y, mesh.vertices[0].z), maxPos = minPos;
+    for (const Vertex& v : mesh.vertices) {
+        minPos = glm::min(minPos, glm::vec3(v.x, v.y, v.z));
+        maxPos = glm::max(maxPos, glm::vec3(v.x, v.y, v.z));
+    }
+    data.boundsCenter = (minPos + maxPos) * 0.5f;
+    for (const Vertex& v : mesh.vertices) {
+        data.boundsRadius = std::max(data.boundsRadius, glm::length(glm::vec3(v.x, v.y, v.z) - data.boundsCenter));
+    }
+    return true;
+}
+
+bool SaveProgressiveMesh(const std::string& path, const ProgressiveMeshData& data) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not write progressive mesh " << path << std::endl;
+        return false;
+    }
+
+    size_t triangleCount = data.baseIndices.size() / 3;
+    for (const ProgressiveRecord& record : data.records) {
+        triangleCount += record.triangles.size() / 3;
+    }
+
+    uint8_t format[4];
+    FormatBytes(data.format, format);
+
+    file.write(kMagic, sizeof(kMagic));
+    WriteValue(file, kVersion);
+    WriteValue(file, static_cast<uint32_t>(data.baseVertices.size() + data.records.size()));
+    WriteValue(file, static_cast<uint32_t>(triangleCount));
+    WriteValue(file, static_cast<uint32_t>(data.baseVertices.size()));
+    WriteValue(file, static_cast<uint32_t>(data.baseIndices.size() / 3));
+    WriteValue(file, static_cast<uint32_t>(data.records.size()));
+    file.write(reinterpret_cast<const char*>(format), sizeof(format));
+    WriteValue(file, data.quantization);
+    WriteValue(file, data.boundsCenter);
+    WriteValue(file, data.boundsRadius);
+    WriteValue(file, data.baseError);
+    WriteValue(file, data.baseRatio);
+
+    WriteValues(file, data.baseVertices);
+    WriteValues(file, data.baseIndices);
+
+    for (const ProgressiveRecord& record : data.records) {
+        WriteValue(file, static_cast<uint32_t>(record.triangles.size() / 3));
+        WriteValue(file, static_cast<uint32_t>(record.corners.size()));
+        WriteValue(file, record.error);
+        WriteValue(file, record.vertex);
+        WriteValues(file, record.triangles);
+        WriteValues(file, record.corners);
+    }
+
+    if (!file.good()) {
+        std::cerr << "Error: Failed while writing progressive mesh " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool IsProgressiveMeshStale(const std::string& path, const std::string& sourcePath, const ProgressiveMeshOptions& options) {
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        return true;
+    }
+    auto meshTime = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return true;
+    }
+    auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+    if (!error && sourceTime > meshTime) {
+        return true;
+    }
+
+    // The settings are part of the fixed header
+    std::vector<char> header(kHeaderSize);
+    std::ifstream file(path, std::ios::binary);
+    file.read(header.data(), header.size());
+    if (!file || std::memcmp(header.data(), kMagic, sizeof(kMagic)) != 0) {
+        return true;
+    }
+    uint32_t version = 0;
+    float baseRatio = 0.0f;
+    uint8_t format[4];
+    FormatBytes(options.format, format);
+    std::memcpy(&version, header.data() + sizeof(kMagic), sizeof(version));
+    std::memcpy(&baseRatio, header.data() + kHeaderSize - sizeof(float), sizeof(baseRatio));
+    return version != kVersion || std::memcmp(header.data() + kFormatOffset, format, sizeof(format)) != 0
+        || baseRatio != options.baseRatio;
+}
+
+void FeedProgressiveMesh(ProgressiveMeshStream& stream, const char* data, size_t size) {
+    stream.pending.insert(stream.pending.end(), data, data + size);
+}
+
+size_t RefineProgressiveMesh(ProgressiveMeshStream& stream, size_t recordBudget) {
+    if (stream.failed) {
+        return 0;
+    }
+
+    size_t consumed = 0;
+    if (!stream.headerRead) {
+        consumed += ParseHeader(stream);
+    }
+
+    size_t applied = 0;
+    if (stream.headerRead && stream.mesh.vao == 0 && !stream.failed) {
+        consumed += ParseBase(stream, stream.pending.data() + consumed, stream.pending.size() - consumed);
+    }
+    if (stream.mesh.vao != 0) {
+        while (applied < recordBudget && stream.recordsApplied < stream.recordCount && !stream.failed) {
+            size_t bytes = ApplyRecord(stream, stream.pending.data() + consumed, stream.pending.size() - consumed);
+            if (bytes == 0) {
+                break;
+            }
+            consumed += bytes;
+            applied++;
+        }
+        UploadStreamChanges(stream);
+    }
+
+    if (stream.failed) {
+        std::cerr << "Error: Invalid progressive mesh data" << std::endl;
+    }
+    stream.pending.erase(stream.pending.begin(), stream.pending.begin() + consumed);
+    return applied;
+}
+
+bool IsProgressiveMeshComplete(const ProgressiveMeshStream& stream) {
+    return stream.headerRead && stream.mesh.vao != 0 && stream.recordsApplied == stream.recordCount;
+}
+
+void UnloadProgressiveMesh(ProgressiveMeshStream& stream) {
+    Unload(stream.mesh.vao, stream.mesh.vbo, stream.ebo);
+    stream = ProgressiveMeshStream();
+}
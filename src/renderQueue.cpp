@@ -0,0 +1,300 @@
+#include <glad/glad.h>
+#include "renderQueue.h"
+#include "uniformBuffers.h"
+#include "glState.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+// Key layout from the most significant bit:
+//   depth and opaque: pass (2) | shader (10) | material (12) | vao (12) | depth (24) | unused (4)
+//   transparent:      pass (2) | inverted depth (24) | shader (10) | material (12) | vao (12) | unused (4)
+const int kPassShift = 62;
+
+// Non-negative floats order like their bit patterns, so the top 24 bits make a monotonic depth
+uint64_t DepthBits(float distance) {
+    distance = std::max(distance, 0.0f);
+    uint32_t bits;
+    std::memcpy(&bits, &distance, sizeof(bits));
+    return bits >> 8;
+}
+
+uint64_t MakeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t vao, float distance) {
+    uint64_t state = (uint64_t(shader & 0x3ffu) << 24) | (uint64_t(material & 0xfffu) << 12) | uint64_t(vao & 0xfffu);
+    uint64_t depth = DepthBits(distance);
+    uint64_t key = uint64_t(pass) << kPassShift;
+    if (pass == RenderPass::Transparent) {
+        return key | ((~depth & 0xffffffu) << 38) | (state << 4);
+    }
+    return key | (state << 28) | (depth << 4);
+}
+
+void PushCommand(
+    RenderQueue& queue, RenderPass pass, const Mesh& mesh, unsigned int vao, Shader& shader,
+    const Material* material, unsigned int object, const StaticBatch* batch = nullptr)
+{
+    const glm::mat4& model = queue.objects[object].model;
+    glm::vec3 center = glm::vec3(model * glm::vec4(mesh.boundsCenter, 1.0f));
+    float distance = glm::length(center - queue.camera->Position);
+
+    uint32_t materialId = 0;
+    if (material) {
+        materialId = queue.materialIds.emplace(material, static_cast<uint32_t>(queue.materialIds.size() + 1)).first->second;
+    }
+
+    // The depth and lighting passes pick the same level, so their depth matches for GL_LEQUAL
+    unsigned int level = SelectMeshLod(mesh, model, *queue.camera, queue.screenHeight);
+    queue.commands.push_back({ &mesh, &shader, material, vao, level, object, batch });
+    queue.keys.push_back(MakeKey(pass, shader.ID, materialId, vao, distance));
+}
+
+RenderPass PassOf(uint64_t key) {
+    return static_cast<RenderPass>(key >> kPassShift);
+}
+
+// State bound by the last executed command
+struct BoundState {
+    Shader* shader = nullptr;
+    const Material* material = nullptr;
+    unsigned int vao = 0;
+    bool vaoBound = false;
+    unsigned int object = static_cast<unsigned int>(-1);
+};
+
+// Rebind only the state that differs from the previous command
+void BindCommandState(RenderQueue& queue, const RenderCommand& command, BoundState& bound) {
+    if (command.shader != bound.shader) {
+        command.shader->use();
+        bound.shader = command.shader;
+        bound.material = nullptr; // Sampler and material uniforms belong to the program
+        queue.shaderChanges++;
+    }
+    if (command.material && command.material != bound.material) {
+        BindMaterial(*command.shader, *command.material);
+        bound.material = command.material;
+        queue.materialChanges++;
+    }
+    if (!bound.vaoBound || command.vao != bound.vao) {
+        CachedBindVertexArray(command.vao);
+        bound.vao = command.vao;
+        bound.vaoBound = true;
+        queue.vaoChanges++;
+    }
+    if (command.object != bound.object) {
+        const RenderObject& object = queue.objects[command.object];
+        SetObjectUniforms(object.model, object.format, object.quantization);
+        bound.object = command.object;
+    }
+}
+
+// Source ranges of a static batch left after frustum culling, for glMultiDrawElementsBaseVertex
+void CullBatchCommand(
+    const RenderQueue& queue, const RenderCommand& command,
+    std::vector<int>& counts, std::vector<const void*>& offsets, std::vector<int>& baseVertices)
+{
+    counts.clear();
+    offsets.clear();
+    baseVertices.clear();
+    const glm::mat4& model = queue.objects[command.object].model;
+    CullStaticBatch(*command.batch, *command.mesh, queue.viewProjection * model, counts, offsets, baseVertices);
+}
+
+// Commands that can go into one multi-draw: the object uniforms are per draw call, so the object must match too
+bool SharesState(const RenderCommand& a, const RenderCommand& b) {
+    return a.shader == b.shader && a.material == b.material && a.vao == b.vao
+        && a.object == b.object && a.mesh->indexType == b.mesh->indexType;
+}
+
+} // namespace
+
+void BeginRenderQueue(RenderQueue& queue, Camera& camera, const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT) {
+    queue.commands.clear();
+    queue.keys.clear();
+    queue.objects.clear();
+    queue.order.clear();
+    queue.materialIds.clear();
+    queue.shaderChanges = 0;
+    queue.materialChanges = 0;
+    queue.vaoChanges = 0;
+    std::fill(std::begin(queue.drawCalls), std::end(queue.drawCalls), 0);
+    queue.camera = &camera;
+    queue.screenHeight = SCR_HEIGHT;
+    queue.viewProjection = ProjectionMatrix(camera, SCR_WIDTH, SCR_HEIGHT) * camera.GetViewMatrix();
+}
+
+void SubmitMesh(
+    RenderQueue& queue, RenderPass pass, Mesh& mesh, unsigned int vao, Shader& shader,
+    const Material* material, const glm::mat4& model)
+{
+    unsigned int object = static_cast<unsigned int>(queue.objects.size());
+    queue.objects.push_back({ model, mesh.format, mesh.quantization });
+    PushCommand(queue, pass, mesh, vao, shader, material, object);
+}
+
+void SubmitModel(RenderQueue& queue, RenderPass pass, Model& model, Shader& shader, const glm::mat4& modelMatrix) {
+    unsigned int object = static_cast<unsigned int>(queue.objects.size());
+    queue.objects.push_back({ modelMatrix, model.format, model.quantization });
+    for (size_t i = 0; i < model.submeshes.size(); ++i) {
+        const Material* material = pass == RenderPass::Depth ? nullptr : &model.materials[model.submeshes[i].materialId];
+        PushCommand(queue, pass, model.meshes[i], model.vao, shader, material, object);
+    }
+}
+
+void SubmitModel(RenderQueue& queue, RenderPass pass, Model& model, ShaderVariantCache& shaders, const glm::mat4& modelMatrix) {
+    unsigned int object = static_cast<unsigned int>(queue.objects.size());
+    queue.objects.push_back({ modelMatrix, model.format, model.quantization });
+    for (size_t i = 0; i < model.submeshes.size(); ++i) {
+        const Material& material = model.materials[model.submeshes[i].materialId];
+        Shader& shader = GetShaderVariant(shaders, MaterialShaderFeatures(material, model.hasTangents));
+        PushCommand(queue, pass, model.meshes[i], model.vao, shader, &material, object);
+    }
+}
+
+void SubmitStaticBatches(
+    RenderQueue& queue, RenderPass pass, const std::vector<StaticBatch>& batches, Model& batchModel, Shader& shader)
+{
+    unsigned int object = static_cast<unsigned int>(queue.objects.size());
+    queue.objects.push_back({ glm::mat4(1.0f), batchModel.format, batchModel.quantization });
+    for (size_t i = 0; i < batches.size() && i < batchModel.submeshes.size(); ++i) {
+        const Material* material = pass == RenderPass::Depth ? nullptr : &batchModel.materials[batchModel.submeshes[i].materialId];
+        PushCommand(queue, pass, batchModel.meshes[i], batchModel.vao, shader, material, object, &batches[i]);
+    }
+}
+
+void SubmitStaticBatches(
+    RenderQueue& queue, RenderPass pass, const std::vector<StaticBatch>& batches, Model& batchModel, ShaderVariantCache& shaders)
+{
+    unsigned int object = static_cast<unsigned int>(queue.objects.size());
+    queue.objects.push_back({ glm::mat4(1.0f), batchModel.format, batchModel.quantization });
+    for (size_t i = 0; i < batches.size() && i < batchModel.submeshes.size(); ++i) {
+        const Material& material = batchModel.materials[batchModel.submeshes[i].materialId];
+        Shader& shader = GetShaderVariant(shaders, MaterialShaderFeatures(material, batchModel.hasTangents));
+        PushCommand(queue, pass, batchModel.meshes[i], batchModel.vao, shader, &material, object, &batches[i]);
+    }
+}
+
+void SortRenderQueue(RenderQueue& queue) {
+    size_t count = queue.keys.size();
+    queue.order.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        queue.order[i] = static_cast<uint32_t>(i);
+    }
+
+    // LSD radix sort on bytes; a byte every key shares needs no pass
+    std::vector<uint32_t> scratch(count);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (uint64_t key : queue.keys) {
+            counts[(key >> shift) & 0xffu]++;
+        }
+        if (std::find(std::begin(counts), std::end(counts), count) != std::end(counts)) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& bucket : counts) {
+            size_t bucketCount = bucket;
+            bucket = offset;
+            offset += bucketCount;
+        }
+        for (uint32_t index : queue.order) {
+            scratch[counts[(queue.keys[index] >> shift) & 0xffu]++] = index;
+        }
+        queue.order.swap(scratch);
+    }
+}
+
+bool IsMultiDrawIndirectSupported() {
+    return GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_multi_draw_indirect;
+}
+
+void ExecuteRenderQueue(RenderQueue& queue, RenderPass pass) {
+    size_t& drawCalls = queue.drawCalls[static_cast<size_t>(pass)];
+
+    // Passes are the top bits, so each one is a contiguous run of the sorted order
+    auto passBegin = std::find_if(queue.order.begin(), queue.order.end(),
+        [&](uint32_t index) { return PassOf(queue.keys[index]) >= pass; });
+    auto passEnd = std::find_if(passBegin, queue.order.end(),
+        [&](uint32_t index) { return PassOf(queue.keys[index]) > pass; });
+    if (passBegin == passEnd) {
+        return;
+    }
+
+    static std::vector<int> counts;
+    static std::vector<const void*> offsets;
+    static std::vector<int> baseVertices;
+
+    BoundState bound;
+    if (!queue.indirect) {
+        for (auto it = passBegin; it != passEnd; ++it) {
+            const RenderCommand& command = queue.commands[*it];
+            if (command.batch) {
+                CullBatchCommand(queue, command, counts, offsets, baseVertices);
+                if (counts.empty()) {
+                    continue; // Every source of the batch was culled
+                }
+                BindCommandState(queue, command, bound);
+                glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), command.mesh->indexType, offsets.data(),
+                    static_cast<GLsizei>(counts.size()), baseVertices.data());
+                drawCalls++;
+                continue;
+            }
+            BindCommandState(queue, command, bound);
+            const RenderObject& object = queue.objects[command.object];
+            DrawMeshElements(*command.mesh, command.level, object.model, queue.viewProjection, queue.camera->Position);
+            drawCalls++;
+        }
+        return;
+    }
+
+    // Group runs of commands sharing every piece of bound state into one multi-draw, then upload all
+    // of the pass's indirect commands at once so each group only needs an offset into the buffer
+    std::vector<IndirectBatch>& batches = queue.indirectBatches;
+    batches.clear();
+    queue.indirectCommands.clear();
+    for (auto it = passBegin; it != passEnd; ++it) {
+        const RenderCommand& command = queue.commands[*it];
+        if (batches.empty() || !SharesState(*batches.back().command, command)) {
+            batches.push_back({ &command, queue.indirectCommands.size(), 0 });
+        }
+        if (command.batch) {
+            CullBatchCommand(queue, command, counts, offsets, baseVertices);
+            size_t indexSize = command.mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+            for (size_t i = 0; i < counts.size(); ++i) {
+                unsigned int firstIndex = static_cast<unsigned int>(reinterpret_cast<uintptr_t>(offsets[i]) / indexSize);
+                queue.indirectCommands.push_back({ static_cast<unsigned int>(counts[i]), 1, firstIndex, baseVertices[i], 0 });
+            }
+        }
+        else {
+            const RenderObject& object = queue.objects[command.object];
+            AppendMeshDrawCommands(*command.mesh, command.level, object.model, queue.viewProjection,
+                queue.camera->Position, queue.indirectCommands);
+        }
+        batches.back().count = queue.indirectCommands.size() - batches.back().first;
+    }
+
+    if (queue.indirectBuffer == 0) {
+        glGenBuffers(1, &queue.indirectBuffer);
+    }
+    CachedBindBuffer(GL_DRAW_INDIRECT_BUFFER, queue.indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, queue.indirectCommands.size() * sizeof(DrawElementsIndirectCommand),
+        queue.indirectCommands.data(), GL_STREAM_DRAW);
+
+    for (const IndirectBatch& batch : batches) {
+        if (batch.count == 0) {
+            continue; // Every meshlet of the group was culled
+        }
+        BindCommandState(queue, *batch.command, bound);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, batch.command->mesh->indexType,
+            (void*)(batch.first * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(batch.count), 0);
+        drawCalls++;
+    }
+}
+
+void ReleaseRenderQueue(RenderQueue& queue) {
+    glDeleteBuffers(1, &queue.indirectBuffer);
+    InvalidateGLState(); // The deleted names may still be shadowed as bound
+    queue.indirectBuffer = 0;
+}
@@ -0,0 +1,77 @@
+#include <glad/glad.h>
+#include "shaderVariants.h"
+#include "uniformBuffers.h"
+
+namespace {
+
+// Define of each feature bit, indexed by bit position
+const char* const kFeatureDefines[] = { "DIFFUSE_MAP", "SPECULAR_MAP", "NORMAL_MAP", "INSTANCING" };
+
+} // namespace
+
+void InitShaderVariants(ShaderVariantCache& cache, const std::string& vertexPath, const std::string& fragmentPath, const std::string& binaryCacheDir) {
+    ReleaseShaderVariants(cache);
+    cache.vertexPath = vertexPath;
+    cache.fragmentPath = fragmentPath;
+    cache.binaryCacheDir = binaryCacheDir;
+}
+
+Shader& GetShaderVariant(ShaderVariantCache& cache, unsigned int features) {
+    auto found = cache.variants.find(features);
+    if (found != cache.variants.end()) {
+        return *found->second;
+    }
+
+    const char* binaryCacheDir = cache.binaryCacheDir.empty() ? nullptr : cache.binaryCacheDir.c_str();
+    std::unique_ptr<Shader> shader(new Shader(cache.vertexPath.c_str(), cache.fragmentPath.c_str(), binaryCacheDir, ShaderFeatureDefines(features)));
+    BindUniformBlocks(*shader);
+    return *(cache.variants[features] = std::move(shader));
+}
+
+void PrepareShaderVariants(ShaderVariantCache& cache, const std::vector<unsigned int>& featureMasks) {
+    for (unsigned int features : featureMasks) {
+        GetShaderVariant(cache, features);
+    }
+}
+
+size_t ReadyShaderVariants(const ShaderVariantCache& cache) {
+    size_t ready = 0;
+    for (const auto& variant : cache.variants) {
+        if (variant.second->isReady()) {
+            ++ready;
+        }
+    }
+    return ready;
+}
+
+unsigned int MaterialShaderFeatures(const Material& material, bool hasTangents) {
+    unsigned int features = 0;
+    if (material.diffuseTexture != 0) {
+        features |= SHADER_FEATURE_DIFFUSE_MAP;
+    }
+    if (material.specularTexture != 0) {
+        features |= SHADER_FEATURE_SPECULAR_MAP;
+    }
+    if (material.normalTexture != 0 && hasTangents) {
+        features |= SHADER_FEATURE_NORMAL_MAP;
+    }
+    return features;
+}
+
+std::vector<std::string> ShaderFeatureDefines(unsigned int features) {
+    std::vector<std::string> defines;
+    for (unsigned int bit = 0; bit < sizeof(kFeatureDefines) / sizeof(kFeatureDefines[0]); ++bit) {
+        if (features & (1u << bit)) {
+            defines.push_back(kFeatureDefines[bit]);
+        }
+    }
+    return defines;
+}
+
+void ReleaseShaderVariants(ShaderVariantCache& cache) {
+    for (auto& variant : cache.variants) {
+        glDeleteProgram(variant.second->ID);
+    }
+    cache.variants.clear();
+    InvalidateGLState(); // A deleted program may still be shadowed as in use
+}
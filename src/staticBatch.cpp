@@ -0,0 +1,215 @@
+#include <glad/glad.h>
+#include "staticBatch.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+glm::vec3 PositionOf(const Vertex& v) {
+    return glm::vec3(v.x, v.y, v.z);
+}
+
+// Normalized frustum planes of a view-projection matrix, in world space
+void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
+    glm::vec4 rows[4];
+    for (int r = 0; r < 4; ++r) {
+        rows[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+    }
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[3] + rows[2];
+    planes[5] = rows[3] - rows[2];
+    for (int p = 0; p < 6; ++p) {
+        planes[p] /= glm::length(glm::vec3(planes[p]));
+    }
+}
+
+// Transform one instance into the batch and record its range
+void AppendInstance(StaticBatch& batch, const StaticInstance& instance, unsigned int source, bool withTangents) {
+    const Mesh& mesh = *instance.mesh;
+    glm::mat3 linear(instance.transform);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+
+    // Mirroring transforms flip the winding and the tangent frame's handedness
+    bool mirrored = glm::determinant(linear) < 0.0f;
+
+    unsigned int baseVertex = static_cast<unsigned int>(batch.mesh.vertices.size());
+    glm::vec3 minPos(0.0f), maxPos(0.0f);
+    for (size_t v = 0; v < mesh.vertices.size(); ++v) {
+        Vertex vertex = mesh.vertices[v];
+        glm::vec3 position = glm::vec3(instance.transform * glm::vec4(PositionOf(vertex), 1.0f));
+        glm::vec3 normal = normalMatrix * glm::vec3(vertex.nx, vertex.ny, vertex.nz);
+        float length = glm::length(normal);
+        normal = length > 0.0f ? normal / length : normal;
+
+        vertex.x = position.x;
+        vertex.y = position.y;
+        vertex.z = position.z;
+        vertex.nx = normal.x;
+        vertex.ny = normal.y;
+        vertex.nz = normal.z;
+        batch.mesh.vertices.push_back(vertex);
+
+        minPos = v == 0 ? position : glm::min(minPos, position);
+        maxPos = v == 0 ? position : glm::max(maxPos, position);
+
+        if (withTangents) {
+            glm::vec4 tangent = mesh.tangents.size() == mesh.vertices.size() ? mesh.tangents[v] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            glm::vec3 axis = linear * glm::vec3(tangent);
+            float axisLength = glm::length(axis);
+            batch.mesh.tangents.push_back(glm::vec4(axisLength > 0.0f ? axis / axisLength : axis, mirrored ? -tangent.w : tangent.w));
+        }
+    }
+
+    BatchRange range;
+    range.source = source;
+    range.indexOffset = static_cast<unsigned int>(batch.mesh.indices.size());
+    range.indexCount = static_cast<unsigned int>(mesh.indices.size() - mesh.indices.size() % 3);
+    range.center = (minPos + maxPos) * 0.5f;
+    range.radius = 0.0f;
+    for (size_t v = baseVertex; v < batch.mesh.vertices.size(); ++v) {
+        range.radius = std::max(range.radius, glm::length(PositionOf(batch.mesh.vertices[v]) - range.center));
+    }
+
+    for (size_t i = 0; i < range.indexCount; i += 3) {
+        unsigned int a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+        if (mirrored) {
+            std::swap(b, c);
+        }
+        batch.mesh.indices.push_back(baseVertex + a);
+        batch.mesh.indices.push_back(baseVertex + b);
+        batch.mesh.indices.push_back(baseVertex + c);
+    }
+    batch.ranges.push_back(range);
+}
+
+// Bounding sphere of the whole batch, used for LOD selection like any other mesh
+void ComputeBatchBounds(StaticBatch& batch) {
+    if (batch.mesh.vertices.empty()) {
+        return;
+    }
+    glm::vec3 minPos = PositionOf(batch.mesh.vertices[0]), maxPos = minPos;
+    for (const Vertex& v : batch.mesh.vertices) {
+        minPos = glm::min(minPos, PositionOf(v));
+        maxPos = glm::max(maxPos, PositionOf(v));
+    }
+    batch.mesh.boundsCenter = (minPos + maxPos) * 0.5f;
+    batch.mesh.boundsRadius = 0.0f;
+    for (const Vertex& v : batch.mesh.vertices) {
+        batch.mesh.boundsRadius = std::max(batch.mesh.boundsRadius, glm::length(PositionOf(v) - batch.mesh.boundsCenter));
+    }
+}
+
+} // namespace
+
+std::vector<StaticBatch> BuildStaticBatches(
+    const std::vector<StaticInstance>& instances, const StaticBatchOptions& options, std::vector<unsigned int>* unbatched)
+{
+    // Group by (shader, material); the stable sort keeps instance order inside each group
+    std::vector<unsigned int> order;
+    for (unsigned int i = 0; i < instances.size(); ++i) {
+        const Mesh* mesh = instances[i].mesh;
+        if (!mesh || mesh->vertices.empty() || mesh->vertices.size() > options.maxSourceVertices) {
+            if (unbatched) {
+                unbatched->push_back(i);
+            }
+            continue;
+        }
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        if (instances[a].shaderId != instances[b].shaderId) {
+            return instances[a].shaderId < instances[b].shaderId;
+        }
+        return instances[a].materialId < instances[b].materialId;
+    });
+
+    std::vector<StaticBatch> batches;
+    for (size_t begin = 0; begin < order.size();) {
+        const StaticInstance& first = instances[order[begin]];
+
+        // Collect one group, closing batches before they outgrow the vertex limit
+        size_t end = begin;
+        while (end < order.size() && instances[order[end]].shaderId == first.shaderId && instances[order[end]].materialId == first.materialId) {
+            end++;
+        }
+
+        bool withTangents = false;
+        for (size_t i = begin; i < end; ++i) {
+            withTangents = withTangents || !instances[order[i]].mesh->tangents.empty();
+        }
+
+        StaticBatch* batch = nullptr;
+        for (size_t i = begin; i < end; ++i) {
+            const StaticInstance& instance = instances[order[i]];
+            if (!batch || batch->mesh.vertices.size() + instance.mesh->vertices.size() > options.maxBatchVertices) {
+                batches.emplace_back();
+                batch = &batches.back();
+                batch->mesh.material = first.mesh->material;
+                batch->materialId = first.materialId;
+                batch->shaderId = first.shaderId;
+            }
+            AppendInstance(*batch, instance, order[i], withTangents);
+        }
+        begin = end;
+    }
+
+    for (StaticBatch& batch : batches) {
+        ComputeBatchBounds(batch);
+    }
+    return batches;
+}
+
+size_t CullStaticBatch(
+    const StaticBatch& batch, const Mesh& uploaded, const glm::mat4& viewProjection,
+    std::vector<int>& counts, std::vector<const void*>& offsets, std::vector<int>& baseVertices)
+{
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(viewProjection, planes);
+
+    size_t indexSize = uploaded.indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    size_t culled = 0;
+    bool extendLast = false;
+
+    for (const BatchRange& range : batch.ranges) {
+        bool visible = true;
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), range.center) + plane.w < -range.radius) {
+                visible = false;
+                break;
+            }
+        }
+
+        if (!visible) {
+            culled++;
+            extendLast = false;
+            continue;
+        }
+
+        // Ranges are stored back to back, so a run of visible sources is one draw
+        if (extendLast) {
+            counts.back() += static_cast<int>(range.indexCount);
+        }
+        else {
+            counts.push_back(static_cast<int>(range.indexCount));
+            offsets.push_back((const void*)((uploaded.indexBase + range.indexOffset) * indexSize));
+            baseVertices.push_back(static_cast<int>(uploaded.baseVertex));
+            extendLast = true;
+        }
+    }
+
+    return culled;
+}
+
+int FindBatchSource(const StaticBatch& batch, unsigned int triangle) {
+    unsigned int index = triangle * 3;
+    auto it = std::upper_bound(batch.ranges.begin(), batch.ranges.end(), index,
+        [](unsigned int value, const BatchRange& range) { return value < range.indexOffset; });
+    if (it == batch.ranges.begin()) {
+        return -1;
+    }
+    --it;
+    return index < it->indexOffset + it->indexCount ? static_cast<int>(it->source) : -1;
+}
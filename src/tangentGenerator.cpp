@@ -0,0 +1,428 @@
+#include "tangentGenerator.h"
+#include "riceLoader.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <unordered_map>
+
+// Port of Morten S. Mikkelsen's MikkTSpace (mikktspace.c, zlib licence) with its default
+// 180 degree angular threshold. The float math below follows the reference step for step so
+// baked normal maps decode to the same basis.
+
+namespace {
+
+const int kMarkDegenerate = 1;
+const int kGroupWithAny = 2;
+const int kOrientPreserving = 4;
+
+bool NotZero(float x) {
+    return std::fabs(x) > FLT_MIN;
+}
+
+bool NotZero(const glm::vec3& v) {
+    return NotZero(v.x) || NotZero(v.y) || NotZero(v.z);
+}
+
+float Length(const glm::vec3& v) {
+    return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+glm::vec3 Normalize(const glm::vec3& v) {
+    return (1.0f / Length(v)) * v;
+}
+
+float Dot(const glm::vec3& a, const glm::vec3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Projects v onto the plane of the unit normal n and normalizes it when it isn't zero
+glm::vec3 ProjectNormalized(const glm::vec3& n, const glm::vec3& v) {
+    glm::vec3 p = v - Dot(n, v) * n;
+    return NotZero(p) ? Normalize(p) : p;
+}
+
+struct TriangleInfo {
+    int neighbors[3] = { -1, -1, -1 };  // Face across the edge from corner i to corner i + 1
+    int groups[3] = { -1, -1, -1 };
+    glm::vec3 os = glm::vec3(0.0f), ot = glm::vec3(0.0f);
+    int flags = 0;
+};
+
+// Faces around one welded vertex reached through shared edges with the same UV orientation
+struct TangentGroup {
+    unsigned int vertex;
+    bool orientPreserving;
+    std::vector<int> faces;
+};
+
+struct TangentSpace {
+    glm::vec3 os = glm::vec3(1.0f, 0.0f, 0.0f);
+    bool orientPreserving = false;
+};
+
+// Vertex key for welding; adding 0 folds -0 into +0 so it compares like the reference's ==
+struct WeldKey {
+    float values[8];
+
+    bool operator==(const WeldKey& other) const {
+        for (int i = 0; i < 8; ++i) {
+            if (values[i] != other.values[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+struct WeldKeyHash {
+    size_t operator()(const WeldKey& key) const {
+        size_t hash = 0;
+        for (float value : key.values) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            hash = hash * 31 + bits;
+        }
+        return hash;
+    }
+};
+
+// Finds the edge of a triangle holding both i0 and i1 and returns it in the triangle's winding
+void GetEdge(unsigned int& outI0, unsigned int& outI1, int& edge, const unsigned int* tri,
+    unsigned int i0, unsigned int i1) {
+    if (tri[0] == i0 || tri[0] == i1) {
+        if (tri[1] == i0 || tri[1] == i1) {
+            edge = 0;
+            outI0 = tri[0];
+            outI1 = tri[1];
+        } else {
+            edge = 2;
+            outI0 = tri[2];
+            outI1 = tri[0];
+        }
+    } else {
+        edge = 1;
+        outI0 = tri[1];
+        outI1 = tri[2];
+    }
+}
+
+bool AssignRecursive(const std::vector<unsigned int>& welded, std::vector<TriangleInfo>& triangles,
+    int face, int groupIndex, TangentGroup& group) {
+    TriangleInfo& info = triangles[face];
+    const unsigned int* tri = &welded[face * 3];
+    int i = tri[0] == group.vertex ? 0 : tri[1] == group.vertex ? 1 : 2;
+    if (info.groups[i] == groupIndex) {
+        return true;
+    }
+    if (info.groups[i] != -1) {
+        return false;
+    }
+
+    // The first group to reach a triangle without usable UVs decides its orientation
+    if ((info.flags & kGroupWithAny) != 0 &&
+        info.groups[0] == -1 && info.groups[1] == -1 && info.groups[2] == -1) {
+        info.flags &= ~kOrientPreserving;
+        info.flags |= group.orientPreserving ? kOrientPreserving : 0;
+    }
+    if (((info.flags & kOrientPreserving) != 0) != group.orientPreserving) {
+        return false;
+    }
+
+    group.faces.push_back(face);
+    info.groups[i] = groupIndex;
+    int left = info.neighbors[i];
+    int right = info.neighbors[i > 0 ? i - 1 : 2];
+    if (left >= 0) {
+        AssignRecursive(welded, triangles, left, groupIndex, group);
+    }
+    if (right >= 0) {
+        AssignRecursive(welded, triangles, right, groupIndex, group);
+    }
+    return true;
+}
+
+} // namespace
+
+void GenerateTangents(Mesh& mesh, unsigned int threads)
+{
+    std::vector<Vertex>& vertices = mesh.vertices;
+    std::vector<unsigned int>& indices = mesh.indices;
+    size_t vertexCount = vertices.size();
+    size_t cornerCount = indices.size() - indices.size() % 3;
+    size_t triangleCount = cornerCount / 3;
+
+    // MikkTSpace takes unit normals from its caller
+    std::vector<glm::vec3> positions(vertexCount), normals(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const Vertex& vertex = vertices[v];
+        positions[v] = glm::vec3(vertex.x, vertex.y, vertex.z);
+        glm::vec3 n(vertex.nx, vertex.ny, vertex.nz);
+        normals[v] = NotZero(n) ? Normalize(n) : glm::vec3(0.0f, 0.0f, 1.0f);
+    }
+
+    // Corners with identical position, normal and UV share one welded vertex
+    std::vector<unsigned int> weld(vertexCount);
+    {
+        std::unordered_map<WeldKey, unsigned int, WeldKeyHash> firstVertex;
+        firstVertex.reserve(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            const glm::vec3& p = positions[v];
+            const glm::vec3& n = normals[v];
+            WeldKey key = { { p.x + 0.0f, p.y + 0.0f, p.z + 0.0f, n.x + 0.0f, n.y + 0.0f, n.z + 0.0f,
+                vertices[v].tx + 0.0f, vertices[v].ty + 0.0f } };
+            weld[v] = firstVertex.emplace(key, static_cast<unsigned int>(v)).first->second;
+        }
+    }
+    std::vector<unsigned int> welded(cornerCount);
+    for (size_t c = 0; c < cornerCount; ++c) {
+        welded[c] = weld[indices[c]];
+    }
+
+    // Triangles with two coincident positions take their frame from a good neighbour at the end
+    std::vector<TriangleInfo> triangles(triangleCount);
+    std::vector<int> goodTriangles;
+    goodTriangles.reserve(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const glm::vec3& p0 = positions[welded[t * 3]];
+        const glm::vec3& p1 = positions[welded[t * 3 + 1]];
+        const glm::vec3& p2 = positions[welded[t * 3 + 2]];
+        if (p0 == p1 || p0 == p2 || p1 == p2) {
+            triangles[t].flags = kMarkDegenerate;
+        } else {
+            goodTriangles.push_back(static_cast<int>(t));
+        }
+    }
+
+    // First order derivatives; triangles without usable UVs may join any group
+    ParallelFor(goodTriangles.size(), [&](size_t begin, size_t end) {
+        for (size_t g = begin; g < end; ++g) {
+            size_t t = goodTriangles[g];
+            TriangleInfo& info = triangles[t];
+            info.flags |= kGroupWithAny;
+
+            const Vertex& a = vertices[welded[t * 3]];
+            const Vertex& b = vertices[welded[t * 3 + 1]];
+            const Vertex& c = vertices[welded[t * 3 + 2]];
+            float t21x = b.tx - a.tx, t21y = b.ty - a.ty;
+            float t31x = c.tx - a.tx, t31y = c.ty - a.ty;
+            glm::vec3 d1 = positions[welded[t * 3 + 1]] - positions[welded[t * 3]];
+            glm::vec3 d2 = positions[welded[t * 3 + 2]] - positions[welded[t * 3]];
+
+            float signedAreaSTx2 = t21x * t31y - t21y * t31x;
+            glm::vec3 os = t31y * d1 - t21y * d2;
+            glm::vec3 ot = -t31x * d1 + t21x * d2;
+            info.flags |= signedAreaSTx2 > 0.0f ? kOrientPreserving : 0;
+
+            if (NotZero(signedAreaSTx2)) {
+                float absArea = std::fabs(signedAreaSTx2);
+                float lenOs = Length(os), lenOt = Length(ot);
+                float s = (info.flags & kOrientPreserving) == 0 ? -1.0f : 1.0f;
+                if (NotZero(lenOs)) {
+                    info.os = (s / lenOs) * os;
+                }
+                if (NotZero(lenOt)) {
+                    info.ot = (s / lenOt) * ot;
+                }
+                if (NotZero(lenOs / absArea) && NotZero(lenOt / absArea)) {
+                    info.flags &= ~kGroupWithAny;
+                }
+            }
+        }
+    }, threads);
+
+    // Pair up edges shared by two good triangles with opposite winding, first face wins
+    {
+        std::vector<std::tuple<unsigned int, unsigned int, int>> edges;
+        edges.reserve(goodTriangles.size() * 3);
+        for (int t : goodTriangles) {
+            for (int i = 0; i < 3; ++i) {
+                unsigned int i0 = welded[t * 3 + i], i1 = welded[t * 3 + (i < 2 ? i + 1 : 0)];
+                edges.emplace_back(std::min(i0, i1), std::max(i0, i1), t);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (size_t i = 0; i < edges.size(); ++i) {
+            unsigned int i0 = std::get<0>(edges[i]), i1 = std::get<1>(edges[i]);
+            int f = std::get<2>(edges[i]);
+            unsigned int a0, a1;
+            int edgeA;
+            GetEdge(a0, a1, edgeA, &welded[f * 3], i0, i1);
+            if (triangles[f].neighbors[edgeA] != -1) {
+                continue;
+            }
+
+            size_t j = i + 1;
+            int edgeB = 0;
+            bool found = false;
+            while (j < edges.size() && std::get<0>(edges[j]) == i0 && std::get<1>(edges[j]) == i1) {
+                int t = std::get<2>(edges[j]);
+                unsigned int b0, b1;
+                GetEdge(b1, b0, edgeB, &welded[t * 3], i0, i1);
+                if (a0 == b0 && a1 == b1 && triangles[t].neighbors[edgeB] == -1) {
+                    found = true;
+                    break;
+                }
+                ++j;
+            }
+            if (found) {
+                int t = std::get<2>(edges[j]);
+                triangles[f].neighbors[edgeA] = t;
+                triangles[t].neighbors[edgeB] = f;
+            }
+        }
+    }
+
+    // Grow a group from every unassigned corner of a triangle with usable UVs
+    std::vector<TangentGroup> groups;
+    for (int t : goodTriangles) {
+        TriangleInfo& info = triangles[t];
+        if ((info.flags & kGroupWithAny) != 0) {
+            continue;
+        }
+        for (int i = 0; i < 3; ++i) {
+            if (info.groups[i] != -1) {
+                continue;
+            }
+            int groupIndex = static_cast<int>(groups.size());
+            groups.push_back({ welded[t * 3 + i], (info.flags & kOrientPreserving) != 0, { t } });
+            TangentGroup& group = groups.back();
+            info.groups[i] = groupIndex;
+
+            int left = info.neighbors[i];
+            int right = info.neighbors[i > 0 ? i - 1 : 2];
+            if (left >= 0) {
+                AssignRecursive(welded, triangles, left, groupIndex, group);
+            }
+            if (right >= 0) {
+                AssignRecursive(welded, triangles, right, groupIndex, group);
+            }
+        }
+    }
+
+    // Each corner of a group averages the faces of the group its tangent agrees with, weighted by
+    // the corner angle. With the default threshold only exactly opposite tangents are left out.
+    const float thresholdCos = static_cast<float>(std::cos(static_cast<double>((180.0f * 3.14159265358979323846f) / 180.0f)));
+    std::vector<TangentSpace> spaces(cornerCount);
+    ParallelFor(groups.size(), [&](size_t begin, size_t end) {
+        std::vector<std::vector<int>> subGroups;
+        std::vector<TangentSpace> subGroupSpaces;
+        std::vector<int> members;
+        for (size_t g = begin; g < end; ++g) {
+            const TangentGroup& group = groups[g];
+            const glm::vec3& n = normals[group.vertex];
+            subGroups.clear();
+            subGroupSpaces.clear();
+
+            for (int f : group.faces) {
+                const TriangleInfo& info = triangles[f];
+                int index = info.groups[0] == static_cast<int>(g) ? 0 : info.groups[1] == static_cast<int>(g) ? 1 : 2;
+                glm::vec3 os = ProjectNormalized(n, info.os);
+                glm::vec3 ot = ProjectNormalized(n, info.ot);
+
+                members.clear();
+                for (int t : group.faces) {
+                    glm::vec3 os2 = ProjectNormalized(n, triangles[t].os);
+                    glm::vec3 ot2 = ProjectNormalized(n, triangles[t].ot);
+                    bool any = ((info.flags | triangles[t].flags) & kGroupWithAny) != 0;
+                    if (any || f == t || (Dot(os, os2) > thresholdCos && Dot(ot, ot2) > thresholdCos)) {
+                        members.push_back(t);
+                    }
+                }
+                std::sort(members.begin(), members.end());
+
+                size_t s = std::find(subGroups.begin(), subGroups.end(), members) - subGroups.begin();
+                if (s == subGroups.size()) {
+                    TangentSpace space;
+                    space.os = glm::vec3(0.0f);
+                    for (int t : members) {
+                        const TriangleInfo& member = triangles[t];
+                        if ((member.flags & kGroupWithAny) != 0) {
+                            continue;
+                        }
+                        const unsigned int* tri = &welded[t * 3];
+                        int i = tri[0] == group.vertex ? 0 : tri[1] == group.vertex ? 1 : 2;
+                        glm::vec3 memberOs = ProjectNormalized(n, member.os);
+
+                        const glm::vec3& p0 = positions[tri[i > 0 ? i - 1 : 2]];
+                        const glm::vec3& p1 = positions[tri[i]];
+                        const glm::vec3& p2 = positions[tri[i < 2 ? i + 1 : 0]];
+                        glm::vec3 v1 = ProjectNormalized(n, p0 - p1);
+                        glm::vec3 v2 = ProjectNormalized(n, p2 - p1);
+                        float cosAngle = std::min(1.0f, std::max(-1.0f, Dot(v1, v2)));
+                        float angle = static_cast<float>(std::acos(static_cast<double>(cosAngle)));
+
+                        space.os = space.os + angle * memberOs;
+                    }
+                    if (NotZero(space.os)) {
+                        space.os = Normalize(space.os);
+                    }
+                    subGroups.push_back(members);
+                    subGroupSpaces.push_back(space);
+                }
+
+                TangentSpace& out = spaces[f * 3 + index];
+                out = subGroupSpaces[s];
+                out.orientPreserving = group.orientPreserving;
+            }
+        }
+    }, threads);
+
+    // Degenerate triangles copy the first good corner on the same welded vertex
+    {
+        std::unordered_map<unsigned int, size_t> firstGoodCorner;
+        for (int t : goodTriangles) {
+            for (int i = 0; i < 3; ++i) {
+                firstGoodCorner.emplace(welded[t * 3 + i], t * 3 + i);
+            }
+        }
+        for (size_t t = 0; t < triangleCount; ++t) {
+            if ((triangles[t].flags & kMarkDegenerate) == 0) {
+                continue;
+            }
+            for (int i = 0; i < 3; ++i) {
+                auto found = firstGoodCorner.find(welded[t * 3 + i]);
+                if (found != firstGoodCorner.end()) {
+                    spaces[t * 3 + i] = spaces[found->second];
+                }
+            }
+        }
+    }
+
+    // Corners of a vertex that ended up with different frames are split; the first frame keeps
+    // the vertex and the others get copies appended
+    mesh.tangents.assign(vertexCount, glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
+    std::vector<bool> seen(vertexCount, false);
+    std::vector<unsigned int> copyHeads(vertexCount, ~0u);
+    std::vector<unsigned int> nextCopy;
+    for (size_t c = 0; c < cornerCount; ++c) {
+        unsigned int v = indices[c];
+        glm::vec4 frame(spaces[c].os, spaces[c].orientPreserving ? 1.0f : -1.0f);
+        if (!seen[v]) {
+            seen[v] = true;
+            mesh.tangents[v] = frame;
+            continue;
+        }
+        if (mesh.tangents[v] == frame) {
+            continue;
+        }
+
+        unsigned int copy = copyHeads[v];
+        while (copy != ~0u && mesh.tangents[copy] != frame) {
+            copy = nextCopy[copy - vertexCount];
+        }
+        if (copy == ~0u) {
+            copy = static_cast<unsigned int>(vertices.size());
+            Vertex vertex = vertices[v];
+            vertices.push_back(vertex);
+            mesh.tangents.push_back(frame);
+            nextCopy.push_back(copyHeads[v]);
+            copyHeads[v] = copy;
+        }
+        indices[c] = copy;
+    }
+}
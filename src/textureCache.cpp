@@ -0,0 +1,270 @@
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include "textureCache.h"
+#include "parallel.h"
+#include "glState.h"
+
+namespace {
+
+// The same file reached through different relative paths or links shares one entry
+std::string ResolveTexturePath(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path resolved = std::filesystem::weakly_canonical(path, error);
+    if (error) {
+        resolved = std::filesystem::path(path).lexically_normal();
+    }
+    return resolved.string();
+}
+
+GLenum PixelFormat(int channels) {
+    switch (channels) {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 3: return GL_RGB;
+    default: return GL_RGBA;
+    }
+}
+
+GLenum InternalFormat(int channels) {
+    switch (channels) {
+    case 1: return GL_R8;
+    case 2: return GL_RG8;
+    case 3: return GL_RGB8;
+    default: return GL_RGBA8;
+    }
+}
+
+void DecodeWorker(TextureCache* cache) {
+    for (;;) {
+        std::shared_ptr<CachedTexture> entry;
+        {
+            std::unique_lock<std::mutex> lock(cache->mutex);
+            cache->wake.wait(lock, [cache]() { return cache->stopping || !cache->decodeQueue.empty(); });
+            if (cache->stopping) {
+                return;
+            }
+            entry = cache->decodeQueue.front();
+            cache->decodeQueue.pop_front();
+        }
+
+        // Only this worker touches the entry until it is handed back through decoded
+        int width = 0, height = 0, channels = 0;
+        unsigned char* data = stbi_load(entry->path.c_str(), &width, &height, &channels, 0);
+        if (data) {
+            entry->pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+            entry->width = width;
+            entry->height = height;
+            entry->channels = channels;
+            stbi_image_free(data);
+        }
+
+        std::lock_guard<std::mutex> lock(cache->mutex);
+        cache->decoded.push_back(entry);
+    }
+}
+
+// Copy the pixels into a fresh pixel buffer and start the transfer into the texture
+void BeginUpload(CachedTexture& entry) {
+    size_t size = entry.pixels.size();
+    glGenBuffers(1, &entry.pixelBuffer);
+    CachedBindBuffer(GL_PIXEL_UNPACK_BUFFER, entry.pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        std::memcpy(mapped, entry.pixels.data(), size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else {
+        CachedBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // Upload straight from memory instead
+    }
+
+    // Rows of 1 and 3 channel images are not 4 byte aligned in general
+    CachedBindTexture(0, GL_TEXTURE_2D, entry.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat(entry.channels), entry.width, entry.height, 0,
+        PixelFormat(entry.channels), GL_UNSIGNED_BYTE, mapped ? nullptr : entry.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    CachedBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    entry.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    entry.pixels.clear();
+    entry.pixels.shrink_to_fit();
+    entry.state = TextureState::Uploading;
+}
+
+void DeleteEntry(CachedTexture& entry) {
+    if (entry.fence) {
+        glDeleteSync(static_cast<GLsync>(entry.fence));
+        entry.fence = nullptr;
+    }
+    glDeleteBuffers(1, &entry.pixelBuffer);
+    glDeleteTextures(1, &entry.texture);
+    entry.pixelBuffer = 0;
+    entry.texture = 0;
+}
+
+void ReleaseMap(TextureCache& cache, unsigned int& texture) {
+    if (texture != 0) {
+        ReleaseTexture(cache, texture);
+        texture = 0;
+    }
+}
+
+} // namespace
+
+void InitTextureCache(TextureCache& cache, unsigned int threads) {
+    ReleaseTextureCache(cache);
+    unsigned int count = threads != 0 ? threads : std::max(DefaultThreadCount(), 2u) - 1;
+    cache.stopping = false;
+    for (unsigned int i = 0; i < count; ++i) {
+        cache.workers.emplace_back(DecodeWorker, &cache);
+    }
+}
+
+unsigned int AcquireTexture(TextureCache& cache, const std::string& path, const glm::vec4& placeholder) {
+    if (path.empty()) {
+        return 0;
+    }
+    std::string resolved = ResolveTexturePath(path);
+    auto found = cache.byPath.find(resolved);
+    if (found != cache.byPath.end()) {
+        found->second->refCount++;
+        return found->second->texture;
+    }
+
+    auto entry = std::make_shared<CachedTexture>();
+    entry->path = resolved;
+    entry->refCount = 1;
+    glGenTextures(1, &entry->texture);
+    CachedBindTexture(0, GL_TEXTURE_2D, entry->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_FLOAT, &placeholder[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    cache.byPath[resolved] = entry;
+    cache.byTexture[entry->texture] = entry;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.decodeQueue.push_back(entry);
+    }
+    cache.wake.notify_one();
+    return entry->texture;
+}
+
+void ReleaseTexture(TextureCache& cache, unsigned int texture) {
+    auto found = cache.byTexture.find(texture);
+    if (found == cache.byTexture.end()) {
+        return;
+    }
+    std::shared_ptr<CachedTexture> entry = found->second;
+    if (--entry->refCount > 0) {
+        return;
+    }
+
+    // A worker may still hold the entry; its result is dropped by UpdateTextureCache since the count is zero
+    cache.byTexture.erase(found);
+    cache.byPath.erase(entry->path);
+    DeleteEntry(*entry);
+    InvalidateGLState(); // The deleted texture may still be shadowed as bound
+}
+
+void UpdateTextureCache(TextureCache& cache) {
+    std::vector<std::shared_ptr<CachedTexture>> decoded;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        decoded.swap(cache.decoded);
+    }
+    for (const auto& entry : decoded) {
+        if (entry->refCount == 0) {
+            continue;
+        }
+        if (entry->pixels.empty()) {
+            std::cerr << "Error: Texture failed to load at path: " << entry->path << std::endl;
+            entry->state = TextureState::Failed;
+        }
+        else {
+            entry->state = TextureState::Decoded;
+        }
+    }
+
+    // Start transfers until the budget is spent, always at least one so large images still get through
+    size_t budget = cache.uploadBytesPerFrame;
+    bool started = false;
+    for (auto& item : cache.byTexture) {
+        CachedTexture& entry = *item.second;
+        if (entry.state == TextureState::Decoded && (!started || entry.pixels.size() <= budget)) {
+            budget -= std::min(budget, entry.pixels.size());
+            BeginUpload(entry);
+            started = true;
+        }
+        else if (entry.state == TextureState::Uploading) {
+            // Polled without waiting; the pixel buffer is freed once the driver is done reading it
+            GLsync fence = static_cast<GLsync>(entry.fence);
+            if (glClientWaitSync(fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+                glDeleteSync(fence);
+                glDeleteBuffers(1, &entry.pixelBuffer);
+                entry.fence = nullptr;
+                entry.pixelBuffer = 0;
+                entry.state = TextureState::Ready;
+            }
+        }
+    }
+}
+
+size_t PendingTextures(TextureCache& cache) {
+    size_t pending = 0;
+    for (const auto& item : cache.byTexture) {
+        TextureState state = item.second->state;
+        if (state != TextureState::Ready && state != TextureState::Failed) {
+            ++pending;
+        }
+    }
+    return pending;
+}
+
+void AcquireMaterialTextures(TextureCache& cache, Material& material, const std::string& directory) {
+    // Until a normal map arrives its placeholder is the flat tangent space normal
+    auto resolve = [&directory](const std::string& path) {
+        return path.empty() ? path : (std::filesystem::path(directory) / path).string();
+    };
+    material.diffuseTexture = AcquireTexture(cache, resolve(material.texturePath));
+    material.specularTexture = AcquireTexture(cache, resolve(material.specularTexturePath));
+    material.normalTexture = AcquireTexture(cache, resolve(material.normalTexturePath), glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
+    material.textureID = material.diffuseTexture;
+}
+
+void ReleaseMaterialTextures(TextureCache& cache, Material& material) {
+    ReleaseMap(cache, material.diffuseTexture);
+    ReleaseMap(cache, material.specularTexture);
+    ReleaseMap(cache, material.normalTexture);
+    material.textureID = 0;
+}
+
+void ReleaseTextureCache(TextureCache& cache) {
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.stopping = true;
+        cache.decodeQueue.clear();
+    }
+    cache.wake.notify_all();
+    for (std::thread& worker : cache.workers) {
+        worker.join();
+    }
+    cache.workers.clear();
+    cache.decoded.clear();
+
+    for (auto& item : cache.byTexture) {
+        DeleteEntry(*item.second);
+    }
+    cache.byTexture.clear();
+    cache.byPath.clear();
+    InvalidateGLState();
+}
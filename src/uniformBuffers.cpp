@@ -0,0 +1,99 @@
+#include <glad/glad.h>
+#include "uniformBuffers.h"
+#include "glState.h"
+
+namespace {
+
+const size_t kObjectCapacity = 256;
+
+static_assert(sizeof(FrameUniforms) == 176, "FrameUniforms must match the std140 FrameData block");
+static_assert(sizeof(ObjectUniforms) == 192, "ObjectUniforms must match the std140 ObjectData block");
+
+// One frame buffer and a ring of object slots, shared by every draw
+struct UniformBufferState {
+    unsigned int frameBuffer = 0;
+    unsigned int objectBuffer = 0;
+    size_t objectStride = 0; // sizeof(ObjectUniforms) rounded up to the offset alignment
+    size_t objectCount = 0;  // Slots written since the buffer was last orphaned
+};
+
+UniformBufferState state;
+
+void CreateUniformBuffers() {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    size_t align = static_cast<size_t>(alignment > 0 ? alignment : 256);
+    state.objectStride = (sizeof(ObjectUniforms) + align - 1) / align * align;
+
+    glGenBuffers(1, &state.frameBuffer);
+    CachedBindBuffer(GL_UNIFORM_BUFFER, state.frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_STREAM_DRAW);
+    CachedBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, state.frameBuffer);
+
+    glGenBuffers(1, &state.objectBuffer);
+    CachedBindBuffer(GL_UNIFORM_BUFFER, state.objectBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, kObjectCapacity * state.objectStride, nullptr, GL_STREAM_DRAW);
+}
+
+// Give the object buffer fresh storage so slots still read by queued draws are never overwritten
+void OrphanObjectBuffer() {
+    CachedBindBuffer(GL_UNIFORM_BUFFER, state.objectBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, kObjectCapacity * state.objectStride, nullptr, GL_STREAM_DRAW);
+    state.objectCount = 0;
+}
+
+} // namespace
+
+void BindUniformBlocks(Shader& shader) {
+    shader.bindUniformBlock("FrameData", FRAME_UNIFORM_BINDING);
+    shader.bindUniformBlock("ObjectData", OBJECT_UNIFORM_BINDING);
+}
+
+void SetFrameUniforms(
+    const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos,
+    const glm::vec3& lightPos, const glm::vec3& lightColor)
+{
+    if (state.frameBuffer == 0) {
+        CreateUniformBuffers();
+    }
+
+    FrameUniforms frame;
+    frame.view = view;
+    frame.projection = projection;
+    frame.viewPos = glm::vec4(viewPos, 1.0f);
+    frame.lightPos = glm::vec4(lightPos, 1.0f);
+    frame.lightColor = glm::vec4(lightColor, 1.0f);
+
+    CachedBindBuffer(GL_UNIFORM_BUFFER, state.frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &frame, GL_STREAM_DRAW);
+    OrphanObjectBuffer();
+}
+
+void SetObjectUniforms(const glm::mat4& model, const VertexFormat& format, const VertexQuantization& quantization) {
+    if (state.objectBuffer == 0) {
+        CreateUniformBuffers();
+    }
+    if (state.objectCount == kObjectCapacity) {
+        OrphanObjectBuffer();
+    }
+
+    ObjectUniforms object = {};
+    object.model = model;
+    object.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+    object.positionOffset = glm::vec4(quantization.positionOffset, 0.0f);
+    object.positionScale = glm::vec4(quantization.positionScale, 0.0f);
+    object.texCoordDecode = glm::vec4(quantization.texCoordOffset, quantization.texCoordScale);
+    object.octNormals = format.normal != NormalFormat::Float32 ? 1 : 0;
+
+    size_t offset = state.objectCount++ * state.objectStride;
+    CachedBindBuffer(GL_UNIFORM_BUFFER, state.objectBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(ObjectUniforms), &object);
+    CachedBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORM_BINDING, state.objectBuffer, offset, sizeof(ObjectUniforms));
+}
+
+void ReleaseUniformBuffers() {
+    glDeleteBuffers(1, &state.frameBuffer);
+    glDeleteBuffers(1, &state.objectBuffer);
+    InvalidateGLState();
+    state = UniformBufferState();
+}
@@ -0,0 +1,247 @@
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include "vertexFormat.h"
+#include "riceLoader.h"
+
+namespace {
+
+size_t PositionSize(PositionFormat format) {
+    return format == PositionFormat::Float32 ? 3 * sizeof(float) : 3 * sizeof(uint16_t);
+}
+
+size_t NormalSize(NormalFormat format) {
+    switch (format) {
+    case NormalFormat::OctSnorm16: return 2 * sizeof(int16_t);
+    case NormalFormat::OctSnorm8:  return 2 * sizeof(int8_t);
+    default:                       return 3 * sizeof(float);
+    }
+}
+
+size_t TexCoordSize(TexCoordFormat format) {
+    return format == TexCoordFormat::Float32 ? 2 * sizeof(float) : 2 * sizeof(uint16_t);
+}
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+void Store(unsigned char* dst, const T& value) {
+    std::memcpy(dst, &value, sizeof(T));
+}
+
+} // namespace
+
+VertexLayout GetVertexLayout(const VertexFormat& format) {
+    // Attributes keep the Vertex order and each starts on 4 bytes, which drivers fetch without a slow path.
+    // The exception is an 8 bit octahedral normal behind a 16 bit position: it takes the last two bytes of
+    // the position's second word instead of padding, so it never straddles a word either.
+    VertexLayout layout;
+    layout.positionOffset = 0;
+    layout.normalWithPosition = format.position != PositionFormat::Float32 && format.normal == NormalFormat::OctSnorm8;
+    size_t positionEnd = PositionSize(format.position) + (layout.normalWithPosition ? NormalSize(format.normal) : 0);
+
+    size_t texCoordStart = format.splitPositions ? 0 : positionEnd;
+    layout.texCoordOffset = AlignUp(texCoordStart, 4);
+    size_t texCoordEnd = layout.texCoordOffset + TexCoordSize(format.texCoord);
+
+    if (layout.normalWithPosition) {
+        layout.normalOffset = PositionSize(format.position);
+        layout.stride = AlignUp(texCoordEnd, 4);
+    }
+    else {
+        layout.normalOffset = AlignUp(texCoordEnd, 4);
+        layout.stride = AlignUp(layout.normalOffset + NormalSize(format.normal), 4);
+    }
+
+    if (format.splitPositions) {
+        layout.positionStride = AlignUp(positionEnd, 4);
+        layout.bytesPerVertex = layout.positionStride + layout.stride;
+    }
+    else {
+        layout.positionStride = layout.stride;
+        layout.bytesPerVertex = layout.stride;
+    }
+    return layout;
+}
+
+size_t GetAttributeStreamOffset(const VertexFormat& format, size_t vertexCount) {
+    return format.splitPositions ? vertexCount * GetVertexLayout(format).positionStride : 0;
+}
+
+VertexQuantization ComputeVertexQuantization(const std::vector<Vertex>& vertices, const VertexFormat& format) {
+    VertexQuantization quantization;
+    if (vertices.empty()) {
+        return quantization;
+    }
+
+    // Half positions are normalized too: far from the origin their 10 bit mantissa would snap to a coarse grid
+    if (format.position != PositionFormat::Float32) {
+        glm::vec3 minPos(vertices[0].x, vertices[0].y, vertices[0].z), maxPos = minPos;
+        for (const Vertex& v : vertices) {
+            minPos = glm::min(minPos, glm::vec3(v.x, v.y, v.z));
+            maxPos = glm::max(maxPos, glm::vec3(v.x, v.y, v.z));
+        }
+        // Both span [-1, 1], so the scale is the half extent around the box center
+        quantization.positionOffset = (minPos + maxPos) * 0.5f;
+        quantization.positionScale = glm::max((maxPos - minPos) * 0.5f, glm::vec3(1e-8f));
+    }
+
+    if (format.texCoord == TexCoordFormat::Unorm16) {
+        glm::vec2 minUV(vertices[0].tx, vertices[0].ty), maxUV = minUV;
+        for (const Vertex& v : vertices) {
+            minUV = glm::min(minUV, glm::vec2(v.tx, v.ty));
+            maxUV = glm::max(maxUV, glm::vec2(v.tx, v.ty));
+        }
+        quantization.texCoordOffset = minUV;
+        quantization.texCoordScale = glm::max(maxUV - minUV, glm::vec2(1e-8f));
+    }
+
+    return quantization;
+}
+
+glm::vec2 OctEncode(const glm::vec3& n) {
+    glm::vec3 v = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    glm::vec2 p(v.x, v.y);
+    if (v.z < 0.0f) {
+        // Fold the lower hemisphere over the diagonals
+        p = (1.0f - glm::abs(glm::vec2(v.y, v.x))) * glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return p;
+}
+
+glm::vec3 OctDecode(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    if (n.z < 0.0f) {
+        glm::vec2 folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * glm::vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        n.x = folded.x;
+        n.y = folded.y;
+    }
+    return glm::normalize(n);
+}
+
+std::vector<unsigned char> PackVertices(const std::vector<Vertex>& vertices, const VertexFormat& format, const VertexQuantization& quantization) {
+    VertexLayout layout = GetVertexLayout(format);
+    std::vector<unsigned char> packed(vertices.size() * layout.bytesPerVertex, 0);
+    size_t attributeStream = GetAttributeStreamOffset(format, vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        unsigned char* dst = packed.data() + attributeStream + i * layout.stride;
+
+        // Position
+        unsigned char* pos = packed.data() + i * layout.positionStride + layout.positionOffset;
+        if (format.position == PositionFormat::Float32) {
+            Store(pos, glm::vec3(v.x, v.y, v.z));
+        }
+        else if (format.position == PositionFormat::Half) {
+            glm::vec3 q = (glm::vec3(v.x, v.y, v.z) - quantization.positionOffset) / quantization.positionScale;
+            Store(pos + 0, glm::packHalf1x16(q.x));
+            Store(pos + 2, glm::packHalf1x16(q.y));
+            Store(pos + 4, glm::packHalf1x16(q.z));
+        }
+        else {
+            glm::vec3 q = (glm::vec3(v.x, v.y, v.z) - quantization.positionOffset) / quantization.positionScale;
+            Store(pos + 0, glm::packSnorm1x16(q.x));
+            Store(pos + 2, glm::packSnorm1x16(q.y));
+            Store(pos + 4, glm::packSnorm1x16(q.z));
+        }
+
+        // Texture coordinates
+        unsigned char* tex = dst + layout.texCoordOffset;
+        if (format.texCoord == TexCoordFormat::Float32) {
+            Store(tex, glm::vec2(v.tx, v.ty));
+        }
+        else {
+            glm::vec2 q = (glm::vec2(v.tx, v.ty) - quantization.texCoordOffset) / quantization.texCoordScale;
+            Store(tex + 0, glm::packUnorm1x16(q.x));
+            Store(tex + 2, glm::packUnorm1x16(q.y));
+        }
+
+        // Normal
+        unsigned char* nrm = (layout.normalWithPosition ? pos : dst) + layout.normalOffset;
+        glm::vec3 normal(v.nx, v.ny, v.nz);
+        if (format.normal == NormalFormat::Float32) {
+            Store(nrm, normal);
+        }
+        else {
+            float length = glm::length(normal);
+            glm::vec2 oct = length > 0.0f ? OctEncode(normal / length) : glm::vec2(0.0f);
+            if (format.normal == NormalFormat::OctSnorm16) {
+                Store(nrm + 0, glm::packSnorm1x16(oct.x));
+                Store(nrm + 2, glm::packSnorm1x16(oct.y));
+            }
+            else {
+                Store(nrm + 0, glm::packSnorm1x8(oct.x));
+                Store(nrm + 1, glm::packSnorm1x8(oct.y));
+            }
+        }
+    }
+
+    return packed;
+}
+
+void SetupVertexAttributes(const VertexFormat& format, size_t vertexCount) {
+    VertexLayout layout = GetVertexLayout(format);
+    GLsizei positionStride = static_cast<GLsizei>(layout.positionStride);
+    GLsizei stride = static_cast<GLsizei>(layout.stride);
+    size_t attributeStream = GetAttributeStreamOffset(format, vertexCount);
+    size_t texCoordOffset = attributeStream + layout.texCoordOffset;
+    size_t normalOffset = (layout.normalWithPosition ? 0 : attributeStream) + layout.normalOffset;
+    GLsizei normalStride = layout.normalWithPosition ? positionStride : stride;
+
+    switch (format.position) {
+    case PositionFormat::Float32:
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, positionStride, (void*)layout.positionOffset);
+        break;
+    case PositionFormat::Half:
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, positionStride, (void*)layout.positionOffset);
+        break;
+    case PositionFormat::Snorm16:
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, positionStride, (void*)layout.positionOffset);
+        break;
+    }
+    glEnableVertexAttribArray(0);
+
+    if (format.texCoord == TexCoordFormat::Float32) {
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)texCoordOffset);
+    }
+    else {
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)texCoordOffset);
+    }
+    glEnableVertexAttribArray(1);
+
+    // Octahedral normals only feed xy; the shader decodes them when octNormals is set
+    switch (format.normal) {
+    case NormalFormat::Float32:
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, normalStride, (void*)normalOffset);
+        break;
+    case NormalFormat::OctSnorm16:
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, normalStride, (void*)normalOffset);
+        break;
+    case NormalFormat::OctSnorm8:
+        glVertexAttribPointer(2, 2, GL_BYTE, GL_TRUE, normalStride, (void*)normalOffset);
+        break;
+    }
+    glEnableVertexAttribArray(2);
+}
+
+std::vector<unsigned char> PackTangents(const std::vector<glm::vec4>& tangents) {
+    std::vector<unsigned char> packed(tangents.size() * TANGENT_STREAM_STRIDE);
+    for (size_t i = 0; i < tangents.size(); ++i) {
+        unsigned char* dst = packed.data() + i * TANGENT_STREAM_STRIDE;
+        Store(dst + 0, glm::packSnorm1x16(tangents[i].x));
+        Store(dst + 2, glm::packSnorm1x16(tangents[i].y));
+        Store(dst + 4, glm::packSnorm1x16(tangents[i].z));
+        Store(dst + 6, glm::packSnorm1x16(tangents[i].w));
+    }
+    return packed;
+}
+
+void SetupTangentAttribute(size_t byteOffset) {
+    glVertexAttribPointer(3, 4, GL_SHORT, GL_TRUE, static_cast<GLsizei>(TANGENT_STREAM_STRIDE), (void*)byteOffset);
+    glEnableVertexAttribArray(3);
+}
@@ -0,0 +1,504 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include "riceLoader.h"
+#include "meshOptimizer.h"
+#include "meshCleaner.h"
+#include "meshAnalyzer.h"
+#include "staticBatch.h"
+#include "meshSimplifier.h"
+#include "meshlets.h"
+#include "meshCache.h"
+#include "tangentGenerator.h"
+#include "progressiveMesh.h"
+
+// Offline mesh processing tool, shares the loader with the viewer
+// usage: riceloader-cli <command> <model.obj> [options]
+
+static void printUsage()
+{
+    std::cout << "usage: riceloader-cli <command> <model.obj> [options]\n"
+        << "\n"
+        << "commands:\n"
+        << "  analyze     report GPU-relevant mesh statistics and optionally fail on thresholds\n"
+        << "  clean       weld duplicate vertices, drop degenerate and repeated triangles, and report the removals\n"
+        << "  optimize    reorder triangles and vertices for the GPU and report ACMR/ATVR\n"
+        << "  lod         build the LOD chain and report triangles and error per level\n"
+        << "  build-cache clean, optimize, build LODs and meshlets, and write a .rlmesh cache\n"
+        << "  build-progressive  clean, optimize and write one mesh as a streamable .rlprog progressive mesh\n"
+        << "  batch       place a grid of copies of the model and report draw calls with static batching\n"
+        << "\n"
+        << "analyze options:\n"
+        << "  --format <full|compact16|compact12>  vertex format for fetch and memory numbers (default full)\n"
+        << "  --split                     assume positions in their own stream\n"
+        << "  --cache-size <n>            post-transform cache size (default 16)\n"
+        << "  --views <n>                 overdraw views (default 8)\n"
+        << "  --max-acmr <x>              fail when the FIFO ACMR of any mesh is above x\n"
+        << "  --max-overdraw <x>          fail when the overdraw of any mesh is above x\n"
+        << "  --max-overfetch <x>         fail when the vertex fetch overfetch of any mesh is above x\n"
+        << "\n"
+        << "clean options:\n"
+        << "  --weld <d>                  weld distance relative to the bounds diagonal (default 1e-5)\n"
+        << "  --attribute-epsilon <e>     allowed UV and normal difference for welding (default 1e-4)\n"
+        << "  --keep-duplicates           keep repeated triangles\n"
+        << "\n"
+        << "optimize options:\n"
+        << "  --no-vcache                 skip vertex cache optimization\n"
+        << "  --no-overdraw               skip overdraw optimization\n"
+        << "  --no-fetch                  skip vertex fetch optimization\n"
+        << "  --overdraw-threshold <t>    allowed ACMR growth for overdraw clusters (default 1.05)\n"
+        << "  --cache-size <n>            FIFO size used for the reported statistics (default 16)\n"
+        << "\n"
+        << "lod options:\n"
+        << "  --errors <e0,e1,...>        error target per level, relative to the mesh radius\n"
+        << "  --reduction <r>             triangle ratio each level aims for (default 0.5)\n"
+        << "\n"
+        << "build-cache options:\n"
+        << "  -o <file>                   output path (default: model path with .rlmesh)\n"
+        << "  --no-clean                  skip the cleaning pass\n"
+        << "  --no-optimize               skip the optimization pass\n"
+        << "  --no-lods                   skip LOD chain generation\n"
+        << "  --no-meshlets               skip meshlet generation\n"
+        << "  --tangents                  generate and store tangents even when no material has a normal map\n"
+        << "\n"
+        << "build-progressive options:\n"
+        << "  -o <file>                   output path (default: model path with .rlprog)\n"
+        << "  --mesh <i>                  mesh of the model to write (default 0)\n"
+        << "  --base-ratio <r>            fraction of the triangles in the base mesh (default 0.05)\n"
+        << "  --format <full|compact16|compact12>  vertex format the stream is packed in (default full)\n"
+        << "  --split                     store positions in their own stream\n"
+        << "\n"
+        << "batch options:\n"
+        << "  --copies <n>                number of copies placed in the grid (default 1000)\n"
+        << "  --max-source-vertices <n>   meshes larger than this stay unbatched (default 4096)\n";
+}
+
+static bool parseVertexFormat(const std::string& name, VertexFormat& format)
+{
+    if (name == "full")
+        format = VertexFormat::Full();
+    else if (name == "compact16")
+        format = VertexFormat::Compact16();
+    else if (name == "compact12")
+        format = VertexFormat::Compact12();
+    else
+    {
+        std::cerr << "Error: Unknown vertex format " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static int runAnalyze(const std::string& modelPath, int argc, char** argv)
+{
+    MeshAnalyzeOptions options;
+    float maxAcmr = 0.0f, maxOverdraw = 0.0f, maxOverfetch = 0.0f;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            if (!parseVertexFormat(argv[++i], options.format))
+                return EXIT_FAILURE;
+        }
+        else if (std::strcmp(argv[i], "--split") == 0)
+            options.format.splitPositions = true;
+        else if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+            options.cacheSize = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--views") == 0 && i + 1 < argc)
+            options.overdrawViews = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--max-acmr") == 0 && i + 1 < argc)
+            maxAcmr = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--max-overdraw") == 0 && i + 1 < argc)
+            maxOverdraw = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--max-overfetch") == 0 && i + 1 < argc)
+            maxOverfetch = static_cast<float>(std::atof(argv[++i]));
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Mesh> meshes;
+    LoadModel(modelPath, meshes);
+    if (meshes.empty())
+    {
+        std::cerr << "Error: No meshes loaded from " << modelPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    bool passed = true;
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        MeshAnalysis analysis = AnalyzeMesh(meshes[i], options);
+        std::cout << "mesh " << i << ": " << analysis.vertexCount << " vertices, " << analysis.indexCount << " indices, "
+            << analysis.triangleCount << " triangles\n"
+            << "  unique vertex ratio " << analysis.uniqueVertexRatio << "\n"
+            << "  FIFO ACMR " << analysis.fifo.acmr << ", ATVR " << analysis.fifo.atvr << "\n"
+            << "  LRU  ACMR " << analysis.lru.acmr << ", ATVR " << analysis.lru.atvr << "\n"
+            << "  overdraw " << analysis.overdraw << "\n"
+            << "  vertex fetch overfetch " << analysis.fetchOverfetch << "\n"
+            << "  bytes per triangle " << analysis.bytesPerTriangle << "\n";
+
+        if (maxAcmr > 0.0f && analysis.fifo.acmr > maxAcmr)
+        {
+            std::cerr << "Error: mesh " << i << " ACMR " << analysis.fifo.acmr << " is above " << maxAcmr << std::endl;
+            passed = false;
+        }
+        if (maxOverdraw > 0.0f && analysis.overdraw > maxOverdraw)
+        {
+            std::cerr << "Error: mesh " << i << " overdraw " << analysis.overdraw << " is above " << maxOverdraw << std::endl;
+            passed = false;
+        }
+        if (maxOverfetch > 0.0f && analysis.fetchOverfetch > maxOverfetch)
+        {
+            std::cerr << "Error: mesh " << i << " overfetch " << analysis.fetchOverfetch << " is above " << maxOverfetch << std::endl;
+            passed = false;
+        }
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void printCleanReport(size_t meshIndex, const Mesh& mesh, const MeshCleanReport& report)
+{
+    std::cout << "mesh " << meshIndex << ": " << mesh.vertices.size() << " vertices, " << mesh.indices.size() / 3 << " triangles\n"
+        << "  welded vertices       " << report.weldedVertices << "\n"
+        << "  unreferenced vertices " << report.unreferencedVertices << "\n"
+        << "  degenerate triangles  " << report.degenerateTriangles << "\n"
+        << "  duplicate triangles   " << report.duplicateTriangles << "\n";
+}
+
+static int runClean(const std::string& modelPath, int argc, char** argv)
+{
+    MeshCleanOptions options;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--weld") == 0 && i + 1 < argc)
+            options.weldDistance = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--attribute-epsilon") == 0 && i + 1 < argc)
+            options.attributeEpsilon = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--keep-duplicates") == 0)
+            options.removeDuplicates = false;
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Mesh> meshes;
+    LoadModel(modelPath, meshes);
+    if (meshes.empty())
+    {
+        std::cerr << "Error: No meshes loaded from " << modelPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+        printCleanReport(i, meshes[i], CleanMesh(meshes[i], options));
+
+    return EXIT_SUCCESS;
+}
+
+static int runOptimize(const std::string& modelPath, int argc, char** argv)
+{
+    MeshOptimizeOptions options;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--no-vcache") == 0)
+            options.vertexCache = false;
+        else if (std::strcmp(argv[i], "--no-overdraw") == 0)
+            options.overdraw = false;
+        else if (std::strcmp(argv[i], "--no-fetch") == 0)
+            options.vertexFetch = false;
+        else if (std::strcmp(argv[i], "--overdraw-threshold") == 0 && i + 1 < argc)
+            options.overdrawThreshold = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+            options.cacheSize = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Mesh> meshes;
+    LoadModel(modelPath, meshes);
+    if (meshes.empty())
+    {
+        std::cerr << "Error: No meshes loaded from " << modelPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        MeshOptimizeReport report = OptimizeMesh(meshes[i], options);
+        std::cout << "mesh " << i << ": " << meshes[i].vertices.size() << " vertices, "
+            << meshes[i].indices.size() / 3 << " triangles\n"
+            << "  ACMR " << report.before.acmr << " -> " << report.after.acmr << "\n"
+            << "  ATVR " << report.before.atvr << " -> " << report.after.atvr << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int runLod(const std::string& modelPath, int argc, char** argv)
+{
+    LodChainOptions options;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--errors") == 0 && i + 1 < argc)
+        {
+            options.errorTargets.clear();
+            std::string list = argv[++i];
+            size_t start = 0;
+            while (start < list.size())
+            {
+                size_t end = list.find(',', start);
+                if (end == std::string::npos)
+                    end = list.size();
+                options.errorTargets.push_back(static_cast<float>(std::atof(list.substr(start, end - start).c_str())));
+                start = end + 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--reduction") == 0 && i + 1 < argc)
+            options.reduction = static_cast<float>(std::atof(argv[++i]));
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Mesh> meshes;
+    LoadModel(modelPath, meshes);
+    if (meshes.empty())
+    {
+        std::cerr << "Error: No meshes loaded from " << modelPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        BuildLodChain(meshes[i], options);
+        std::cout << "mesh " << i << ": radius " << meshes[i].boundsRadius << "\n";
+        for (size_t l = 0; l < meshes[i].lods.size(); ++l)
+        {
+            std::cout << "  LOD " << l << ": " << meshes[i].lods[l].indexCount / 3 << " triangles, error "
+                << meshes[i].lods[l].error << "\n";
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int runBuildCache(const std::string& modelPath, int argc, char** argv)
+{
+    std::string outputPath = modelPath.substr(0, modelPath.find_last_of('.')) + ".rlmesh";
+    MeshBuildSettings settings;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--no-clean") == 0)
+            settings.clean = false;
+        else if (std::strcmp(argv[i], "--no-optimize") == 0)
+            settings.optimize = false;
+        else if (std::strcmp(argv[i], "--no-lods") == 0)
+            settings.lods = false;
+        else if (std::strcmp(argv[i], "--no-meshlets") == 0)
+            settings.meshlets = false;
+        else if (std::strcmp(argv[i], "--tangents") == 0)
+            settings.tangents = true;
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Mesh> meshes;
+    LoadModel(modelPath, meshes);
+    if (meshes.empty())
+    {
+        std::cerr << "Error: No meshes loaded from " << modelPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Normal maps need tangents, so they are built whenever a material has one
+    for (const Mesh& mesh : meshes)
+        settings.tangents = settings.tangents || !mesh.material.normalTexturePath.empty();
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        if (settings.clean)
+            CleanMesh(meshes[i], settings.cleanOptions);
+        if (settings.optimize)
+            OptimizeMesh(meshes[i]);
+        if (settings.tangents)
+            GenerateTangents(meshes[i]);
+        if (settings.lods)
+            BuildLodChain(meshes[i], settings.lodOptions);
+        if (settings.meshlets)
+            BuildMeshlets(meshes[i]);
+
+        std::cout << "mesh " << i << ": " << meshes[i].indices.size() / 3 << " triangles, "
+            << meshes[i].lods.size() << " LODs, " << meshes[i].meshlets.size() << " meshlets\n";
+    }
+
+    if (!SaveMeshCache(outputPath, meshes, settings))
+        return EXIT_FAILURE;
+
+    std::cout << "wrote " << outputPath << "\n";
+    return EXIT_SUCCESS;
+}
+
+static int runBuildProgressive(const std::string& modelPath, int argc, char** argv)
+{
+    std::string outputPath = modelPath.substr(0, modelPath.find_last_of('.')) + ".rlprog";
+    ProgressiveMeshOptions options;
+    size_t meshIndex = 0;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+            meshIndex = static_cast<size_t>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--base-ratio") == 0 && i + 1 < argc)
+            options.baseRatio = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            if (!parseVertexFormat(argv[++i], options.format))
+                return EXIT_FAILURE;
+        }
+        else if (std::strcmp(argv[i], "--split") == 0)
+            options.format.splitPositions = true;
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Mesh> meshes;
+    LoadModel(modelPath, meshes);
+    if (meshIndex >= meshes.size())
+    {
+        std::cerr << "Error: " << modelPath << " has no mesh " << meshIndex << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Mesh& mesh = meshes[meshIndex];
+    CleanMesh(mesh);
+    OptimizeMesh(mesh);
+
+    ProgressiveMeshData data;
+    if (!BuildProgressiveMesh(mesh, options, data) || !SaveProgressiveMesh(outputPath, data))
+        return EXIT_FAILURE;
+
+    size_t triangles = data.baseIndices.size() / 3;
+    for (const ProgressiveRecord& record : data.records)
+        triangles += record.triangles.size() / 3;
+    std::cout << "base: " << data.baseIndices.size() / 3 << " triangles, " << data.baseVertices.size()
+        << " vertices, error " << data.baseError << "\n"
+        << "full: " << triangles << " triangles after " << data.records.size() << " refinements\n"
+        << "wrote " << outputPath << "\n";
+    return EXIT_SUCCESS;
+}
+
+static int runBatch(const std::string& modelPath, int argc, char** argv)
+{
+    StaticBatchOptions options;
+    unsigned int copies = 1000;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--copies") == 0 && i + 1 < argc)
+            copies = static_cast<unsigned int>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--max-source-vertices") == 0 && i + 1 < argc)
+            options.maxSourceVertices = static_cast<size_t>(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Error: Unknown option " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Mesh> meshes;
+    LoadModel(modelPath, meshes);
+    if (meshes.empty())
+    {
+        std::cerr << "Error: No meshes loaded from " << modelPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Material ids come from the model so submeshes sharing a material batch together
+    Model model;
+    BuildModel(meshes, model);
+
+    unsigned int side = 1;
+    while (side * side < copies)
+        side++;
+
+    std::vector<StaticInstance> instances;
+    for (unsigned int c = 0; c < copies; ++c)
+    {
+        glm::mat4 transform = glm::mat4(1.0f);
+        transform[3] = glm::vec4(static_cast<float>(c % side) * 3.0f, 0.0f, static_cast<float>(c / side) * 3.0f, 1.0f);
+        for (size_t m = 0; m < model.meshes.size(); ++m)
+        {
+            StaticInstance instance;
+            instance.mesh = &model.meshes[m];
+            instance.transform = transform;
+            instance.materialId = model.submeshes[m].materialId;
+            instances.push_back(instance);
+        }
+    }
+
+    std::vector<unsigned int> unbatched;
+    std::vector<StaticBatch> batches = BuildStaticBatches(instances, options, &unbatched);
+
+    size_t batchedVertices = 0;
+    for (const StaticBatch& batch : batches)
+        batchedVertices += batch.mesh.vertices.size();
+
+    std::cout << instances.size() << " instances: " << instances.size() << " draw calls unbatched\n"
+        << "  " << batches.size() << " batches (" << batchedVertices << " vertices) + "
+        << unbatched.size() << " unbatched = " << batches.size() + unbatched.size() << " draw calls\n";
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::string command = argv[1];
+    std::string modelPath = argv[2];
+
+    if (command == "analyze")
+        return runAnalyze(modelPath, argc - 3, argv + 3);
+    if (command == "clean")
+        return runClean(modelPath, argc - 3, argv + 3);
+    if (command == "optimize")
+        return runOptimize(modelPath, argc - 3, argv + 3);
+    if (command == "lod")
+        return runLod(modelPath, argc - 3, argv + 3);
+    if (command == "batch")
+        return runBatch(modelPath, argc - 3, argv + 3);
+    if (command == "build-cache")
+        return runBuildCache(modelPath, argc - 3, argv + 3);
+    if (command == "build-progressive")
+        return runBuildProgressive(modelPath, argc - 3, argv + 3);
+
+    std::cerr << "Error: Unknown command " << command << std::endl;
+    printUsage();
+    return EXIT_FAILURE;
+}